@@ -0,0 +1,56 @@
+#pragma once
+#include <limits>
+#include <vector>
+
+// Min-cost perfect assignment on a dense n x n matrix: the Hungarian method
+// with row/column potentials, O(n^3). cost is row-major (row = cell, column =
+// slot). Scratch vectors are kept between calls, so one solver per thread
+// runs allocation-free once it has seen its largest n.
+class HungarianSolver {
+public:
+    // Fills slot_of[row] and returns the total cost of the assignment.
+    long long solve(const std::vector<long long>& cost, int n, std::vector<int>& slot_of) {
+        const long long kInf = std::numeric_limits<long long>::max() / 4;
+        u.assign(n + 1, 0);
+        v.assign(n + 1, 0);
+        p.assign(n + 1, 0);
+        way.assign(n + 1, 0);
+        for (int i = 1; i <= n; ++i) {
+            p[0] = i;
+            int j0 = 0;
+            minv.assign(n + 1, kInf);
+            used.assign(n + 1, 0);
+            do {
+                used[j0] = 1;
+                int i0 = p[j0], j1 = 0;
+                long long delta = kInf;
+                for (int j = 1; j <= n; ++j) {
+                    if (used[j]) continue;
+                    long long cur = cost[(size_t)(i0 - 1) * n + (j - 1)] - u[i0] - v[j];
+                    if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                    if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+                }
+                for (int j = 0; j <= n; ++j) {
+                    if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                    else minv[j] -= delta;
+                }
+                j0 = j1;
+            } while (p[j0] != 0);
+            do {
+                int j1 = way[j0];
+                p[j0] = p[j1];
+                j0 = j1;
+            } while (j0);
+        }
+        slot_of.assign(n, -1);
+        for (int j = 1; j <= n; ++j) slot_of[p[j] - 1] = j - 1;
+        long long total = 0;
+        for (int i = 0; i < n; ++i) total += cost[(size_t)i * n + slot_of[i]];
+        return total;
+    }
+
+private:
+    std::vector<long long> u, v, minv;
+    std::vector<int> p, way;
+    std::vector<char> used;
+};
@@ -0,0 +1,390 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "db.h"
+#include "parse_lef.h"
+#include "parse_def.h"
+#include "preprocess.h"
+#include "placer.h"
+#include "write_def.h"
+#include "snapshot.h"
+#include "telemetry.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+// Every global allocation is counted so each pass can report its heap
+// traffic per evaluated move. noinline keeps GCC from pairing the builtin
+// operator new with the free() below and warning about a mismatch.
+static std::atomic<long long> g_alloc_count(0);
+
+__attribute__((noinline)) void* operator new(std::size_t n) {
+    g_alloc_count++;
+    void* p = std::malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+
+template <typename Pass>
+void runPass(const char* name, Placer& placer, const DesignDB& db, Pass pass) {
+    long long allocs_before = g_alloc_count;
+    PassCounters before = placer.passCounters();
+    auto t0 = Clock::now();
+    pass();
+    auto t1 = Clock::now();
+    long long allocs = g_alloc_count - allocs_before;
+    PassCounters work = placer.passCounters() - before;
+    long long moves = work.moves_evaluated;
+    double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    std::cout << std::left << std::setw(24) << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << ms << " ms"
+              << "  moves=" << moves
+              << "  accepted=" << work.moves_accepted
+              << "  pins=" << work.pins_scanned
+              << "  allocs=" << allocs
+              << std::setprecision(4) << "  allocs/move=" << (moves > 0 ? (double)allocs / moves : 0.0)
+              << "  hpwl=" << calculateTotalHPWL(db) << std::endl;
+}
+
+static void loadDesign(const char* lef, const char* def, DesignDB& db, bool renumber = true) {
+    parseLEF(lef, db);
+    parseDEF(def, db);
+    linkInstMacro(db);
+    stampBlockages(db);
+    assignInstToRows(db);
+    if (renumber) renumberInstances(db);
+    buildNetlistView(db);
+}
+
+// Sliding-window sizes 2..6 from a common start (the design after one
+// GlobalInsertOrSwap), reporting HPWL gained per second of window time.
+static void sweepWindowSizes(const char* lef, const char* def, int threads) {
+    std::cout << "\n--- SlidingWindow size sweep ---" << std::endl;
+    for (int w = 2; w <= 6; ++w) {
+        DesignDB db;
+        loadDesign(lef, def, db);
+        Placer placer(db);
+        placer.initializeBinGrid(100, 100);
+        placer.setNumThreads(threads);
+        placer.runGlobalInsertOrSwap();
+        long long hpwl_before = calculateTotalHPWL(db);
+        long long moves_before = placer.movesEvaluated();
+        auto t0 = Clock::now();
+        placer.runSlidingWindow(w);
+        auto t1 = Clock::now();
+        long long gain = hpwl_before - calculateTotalHPWL(db);
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+
+        std::cout << "window=" << w
+                  << std::fixed << std::setprecision(1) << std::setw(10) << sec * 1000.0 << " ms"
+                  << "  leaves=" << placer.movesEvaluated() - moves_before
+                  << "  gain=" << gain
+                  << std::setprecision(0) << "  gain/s=" << (sec > 0 ? gain / sec : 0.0) << std::endl;
+    }
+}
+
+// Random pairwise swaps against independent-set matching, each from the
+// placement after one GlobalInsertOrSwap, reported as HPWL gained per second.
+static void compareSwapPasses(const char* lef, const char* def, int threads) {
+    std::cout << "\n--- NbbSwap vs IndependentSetMatching ---" << std::endl;
+    struct Config { const char* name; int window, batch; };
+    const Config configs[] = {{"NbbSwap", 0, 0}, {"ISM(8, 32)", 8, 32}, {"ISM(16, 64)", 16, 64}, {"ISM(25, 64)", 25, 64}};
+    for (const Config& cfg : configs) {
+        DesignDB db;
+        loadDesign(lef, def, db);
+        Placer placer(db);
+        placer.initializeBinGrid(100, 100);
+        placer.setNumThreads(threads);
+        placer.runGlobalInsertOrSwap();
+        long long hpwl_before = calculateTotalHPWL(db);
+        auto t0 = Clock::now();
+        if (cfg.window == 0) placer.runNbbSwap((int)db.instances.size());
+        else placer.runIndependentSetMatching(cfg.window, cfg.batch);
+        auto t1 = Clock::now();
+        long long gain = hpwl_before - calculateTotalHPWL(db);
+        double sec = std::chrono::duration<double>(t1 - t0).count();
+        std::cout << std::left << std::setw(12) << cfg.name << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(10) << sec * 1000.0 << " ms"
+                  << "  gain=" << gain
+                  << std::setprecision(0) << "  gain/s=" << (sec > 0 ? gain / sec : 0.0) << std::endl;
+    }
+}
+
+// SlidingWindow(4) with 1 and with `threads` threads from the same start;
+// the parallel pass is scheduled to reproduce the serial result exactly.
+static void checkWindowThreads(const char* lef, const char* def, int threads) {
+    std::cout << "\n--- SlidingWindow(4) threads ---" << std::endl;
+    long long hpwl_serial = -1;
+    int counts[2] = {1, threads};
+    for (int c = 0; c < (threads > 1 ? 2 : 1); ++c) {
+        DesignDB db;
+        loadDesign(lef, def, db);
+        Placer placer(db);
+        placer.initializeBinGrid(100, 100);
+        placer.setNumThreads(counts[c]);
+        placer.runGlobalInsertOrSwap();
+        auto t0 = Clock::now();
+        placer.runSlidingWindow(4);
+        placer.runSlidingWindow(4);
+        auto t1 = Clock::now();
+        long long hpwl = calculateTotalHPWL(db);
+        if (c == 0) hpwl_serial = hpwl;
+        std::cout << "threads=" << counts[c]
+                  << std::fixed << std::setprecision(1) << std::setw(10)
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms"
+                  << "  hpwl=" << hpwl
+                  << (c > 0 ? (hpwl == hpwl_serial ? "  (matches serial)" : "  (DIFFERS from serial)") : "")
+                  << std::endl;
+    }
+}
+
+// TiledInsertOrSwap with 1 and with `threads` threads from the same start.
+// Tiles only see each other through the round's snapshot, so the result
+// must not depend on the thread count.
+static void checkTiledThreads(const char* lef, const char* def, int threads) {
+    std::cout << "\n--- TiledInsertOrSwap threads ---" << std::endl;
+    long long hpwl_serial = -1;
+    double ms_serial = 0.0;
+    int counts[2] = {1, threads};
+    for (int c = 0; c < (threads > 1 ? 2 : 1); ++c) {
+        DesignDB db;
+        loadDesign(lef, def, db);
+        Placer placer(db);
+        placer.initializeBinGrid(100, 100);
+        placer.setNumThreads(counts[c]);
+        placer.runGlobalInsertOrSwap();
+        // Same tiles for both runs, sized for the larger thread count.
+        int tiles = Placer::tilesPerSide(threads);
+        auto t0 = Clock::now();
+        placer.runTiledInsertOrSwap(tiles);
+        auto t1 = Clock::now();
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        long long hpwl = calculateTotalHPWL(db);
+        if (c == 0) { hpwl_serial = hpwl; ms_serial = ms; }
+        std::cout << "threads=" << counts[c]
+                  << std::fixed << std::setprecision(1) << std::setw(10) << ms << " ms"
+                  << "  tiles=" << tiles << "x" << tiles
+                  << "  hpwl=" << hpwl;
+        if (c > 0) {
+            std::cout << std::setprecision(2) << "  speedup=" << (ms > 0 ? ms_serial / ms : 0.0)
+                      << (hpwl == hpwl_serial ? "  (matches serial)" : "  (DIFFERS from serial)");
+        }
+        std::cout << std::endl;
+    }
+}
+
+// GlobalInsertOrSwap on the design in DEF order and in Hilbert order
+// (renumberInstances), with cache misses per evaluated move where the
+// hardware counters are readable. The counters see only the calling thread,
+// so both orders run on a one-thread pool and every move is counted.
+static void compareRenumbering(const char* lef, const char* def) {
+    std::cout << "\n--- Instance order ---" << std::endl;
+    CacheCounters cache;
+    for (int renumber = 0; renumber < 2; ++renumber) {
+        DesignDB db;
+        loadDesign(lef, def, db, renumber == 1);
+        Placer placer(db);
+        placer.initializeBinGrid(100, 100);
+        placer.setNumThreads(1);
+        long long moves_before = placer.movesEvaluated();
+        CacheCounters::Sample c0 = cache.read();
+        auto t0 = Clock::now();
+        placer.runGlobalInsertOrSwap();
+        auto t1 = Clock::now();
+        CacheCounters::Sample c1 = cache.read();
+        long long moves = std::max(1LL, placer.movesEvaluated() - moves_before);
+        std::cout << std::left << std::setw(8) << (renumber ? "Hilbert" : "DEF") << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(10)
+                  << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms"
+                  << "  moves=" << moves;
+        if (cache.available()) {
+            std::cout << std::setprecision(2)
+                      << "  l1d_misses/move=" << (double)(c1.l1d_misses - c0.l1d_misses) / moves
+                      << "  llc_misses/move=" << (double)(c1.llc_misses - c0.llc_misses) / moves;
+        } else {
+            std::cout << "  (cache counters unavailable)";
+        }
+        std::cout << "  hpwl=" << calculateTotalHPWL(db) << std::endl;
+    }
+}
+
+// parseDEF alone with 1 and with `threads` threads, best of three runs each,
+// as input megabytes per second.
+static void measureDefParse(const char* def, int threads) {
+    MappedFile file;
+    if (!file.open(def)) return;
+    double mb = file.size() / 1e6;
+    int counts[2] = {1, threads};
+    for (int c = 0; c < (threads > 1 ? 2 : 1); ++c) {
+        double best = 0.0;
+        for (int run = 0; run < 3; ++run) {
+            DesignDB db;
+            auto t0 = Clock::now();
+            parseDEF(def, db, counts[c]);
+            double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+            if (run == 0 || sec < best) best = sec;
+        }
+        std::cout << "DEF parse (threads=" << counts[c] << "): " << std::fixed << std::setprecision(1)
+                  << mb << " MB in " << best * 1000.0 << " ms (" << (best > 0 ? mb / best : 0.0)
+                  << " MB/s)" << std::endl;
+    }
+}
+
+// Total HPWL the way it was computed before the SoA/SIMD kernel: one pass
+// over the pins with 64-bit min/max. Kept as the reference for the kernel.
+static long long referenceTotalHPWL(const DesignDB& db) {
+    const NetlistView& nl = db.netlist;
+    long long total = 0;
+    for (int net_id = 0; net_id < nl.numNets(); ++net_id) {
+        Span<int32_t> pins = nl.netPins(net_id);
+        if (pins.empty()) continue;
+        long long min_x = std::numeric_limits<long long>::max(), max_x = std::numeric_limits<long long>::min();
+        long long min_y = min_x, max_y = max_x;
+        for (int32_t ref : pins) {
+            long long x = ref >= 0 ? db.instances[ref].x : nl.io_x[~ref];
+            long long y = ref >= 0 ? db.instances[ref].y : nl.io_y[~ref];
+            min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+            min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+        }
+        total += (max_x - min_x) + (max_y - min_y);
+    }
+    return total;
+}
+
+// Full-design HPWL: the reference loop, the kernel on one thread and the
+// kernel on `threads` threads, best of five runs each.
+static void measureTotalHpwl(const DesignDB& db, int threads) {
+    ThreadPool pool(threads);
+    HpwlEvaluator eval;
+    long long expect = referenceTotalHPWL(db);
+    struct Variant { const char* name; int kind; };
+    const Variant variants[] = {{"reference", 0}, {"kernel (1 thread)", 1}, {"kernel (pool)", 2}};
+    for (const Variant& v : variants) {
+        double best = 0.0;
+        long long got = 0;
+        for (int run = 0; run < 5; ++run) {
+            auto t0 = Clock::now();
+            got = v.kind == 0 ? referenceTotalHPWL(db) : eval.total(db, v.kind == 2 ? &pool : nullptr);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            if (run == 0 || ms < best) best = ms;
+        }
+        std::cout << "Total HPWL " << std::left << std::setw(18) << v.name << std::right
+                  << std::fixed << std::setprecision(2) << std::setw(9) << best << " ms  pins="
+                  << db.netlist.pin_ref.size() << (v.kind == 2 ? "  threads=" + std::to_string(threads) : "")
+                  << (got == expect ? "" : "  (MISMATCH)") << std::endl;
+    }
+}
+
+// Saves the preprocessed design as a snapshot in a fresh temporary file
+// (under $TMPDIR, default /tmp), loads it back and checks the HPWL, then
+// removes the file. The testcase directory may be read-only and may hold a
+// snapshot of its own.
+static void measureSnapshot(const DesignDB& db, const char* lef, const char* def) {
+    const char* tmp_dir = std::getenv("TMPDIR");
+    std::string name = std::string(tmp_dir && *tmp_dir ? tmp_dir : "/tmp") + "/hw3snap.XXXXXX";
+    std::vector<char> buf(name.begin(), name.end());
+    buf.push_back('\0');
+    int fd = mkstemp(buf.data());
+    if (fd < 0) {
+        std::cerr << "Snapshot: cannot create a temporary file from " << name << std::endl;
+        return;
+    }
+    close(fd);
+    std::string path(buf.data());
+    auto t0 = Clock::now();
+    bool saved = saveSnapshot(db, lef, def, path);
+    auto t1 = Clock::now();
+    if (!saved) {
+        std::remove(path.c_str());
+        return;
+    }
+    DesignDB loaded;
+    bool ok = loadSnapshot(path, lef, def, loaded);
+    auto t2 = Clock::now();
+    std::remove(path.c_str());
+    std::cout << "Snapshot: save " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms, load "
+              << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms"
+              << (ok && calculateTotalHPWL(loaded) == calculateTotalHPWL(db) ? "  (HPWL matches)" : "  (MISMATCH)")
+              << std::endl;
+}
+
+// writeDEF of the final placement to /dev/null, best of three runs.
+static void measureDefWrite(const DesignDB& db, const char* def) {
+    double best = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        auto t0 = Clock::now();
+        writeDEF(db, def, "/dev/null");
+        double sec = std::chrono::duration<double>(Clock::now() - t0).count();
+        if (run == 0 || sec < best) best = sec;
+    }
+    double mb = db.def_size / 1e6;
+    std::cout << "DEF write: " << std::fixed << std::setprecision(1) << mb << " MB in "
+              << best * 1000.0 << " ms (" << (best > 0 ? mb / best : 0.0) << " MB/s)" << std::endl;
+}
+
+/*
+./../bin/hw3_bench ../testcase/public1.lef ../testcase/public1.def [threads] [--quick]
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: ./hw3_bench <input.lef> <input.def> [threads] [--quick]\n";
+        return 1;
+    }
+    int threads = (int)std::thread::hardware_concurrency();
+    bool quick = false;
+    for (int a = 3; a < argc; ++a) {
+        if (std::string(argv[a]) == "--quick") quick = true;
+        else threads = std::atoi(argv[a]);
+    }
+    if (threads < 1) threads = 1;
+
+    measureDefParse(argv[2], threads);
+
+    DesignDB db;
+    auto t_parse_start = Clock::now();
+    loadDesign(argv[1], argv[2], db);
+    auto t_parse_end = Clock::now();
+    std::cout << "Parsing & Preprocessing: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(t_parse_end - t_parse_start).count()
+              << " ms" << std::endl;
+    std::cout << "Initial HPWL: " << calculateTotalHPWL(db) << std::endl;
+    measureTotalHpwl(db, threads);
+    measureSnapshot(db, argv[1], argv[2]);
+
+    Placer placer(db);
+    placer.initializeBinGrid(100, 100);
+    placer.setNumThreads(threads);
+    int rns_cells = std::min<int>(500000, db.instances.size());
+
+    runPass("GlobalInsertOrSwap", placer, db, [&]{ placer.runGlobalInsertOrSwap(); });
+    runPass("TiledInsertOrSwap", placer, db, [&]{ placer.runTiledInsertOrSwap(Placer::tilesPerSide(threads)); });
+    runPass("IndependentSetMatching", placer, db, [&]{ placer.runIndependentSetMatching(25, 64); });
+    runPass("SlidingWindow(4)", placer, db, [&]{ placer.runSlidingWindow(4); });
+    runPass("RowNeighborhoodSwap", placer, db, [&]{ placer.runRowNeighborhoodSwap(rns_cells, 3); });
+    runPass("SlidingWindow(4)", placer, db, [&]{ placer.runSlidingWindow(4); });
+    runPass("RowLegalize", placer, db, [&]{ placer.runRowLegalize(); });
+    measureDefWrite(db, argv[2]);
+    std::cout << "Final HPWL: " << calculateTotalHPWL(db) << std::endl;
+
+    // The studies below reload the design several times each.
+    if (quick) return 0;
+    sweepWindowSizes(argv[1], argv[2], threads);
+    checkWindowThreads(argv[1], argv[2], threads);
+    checkTiledThreads(argv[1], argv[2], threads);
+    compareRenumbering(argv[1], argv[2]);
+    compareSwapPasses(argv[1], argv[2], threads);
+
+    return 0;
+}
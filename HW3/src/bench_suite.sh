@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# 產生不同規模的合成測資 (預設 1萬 / 10萬 / 100萬 cells)，並對每一個執行 hw3_bench --quick
+# 用法: ./bench_suite.sh [cells ...] ；例如 ./bench_suite.sh 10000 100000 1000000 10000000
+# 結果寫在 ../output/bench_<cells>.log，最後印出每個規模的摘要
+set -e
+
+SIZES=${@:-"10000 100000 1000000"}
+TESTCASE_DIR=../testcase
+OUTPUT_DIR=../output
+
+echo "===== [1/3] 編譯 hw3_gen 與 hw3_bench ====="
+make gen bench
+
+mkdir -p "$TESTCASE_DIR" "$OUTPUT_DIR"
+
+echo "===== [2/3] 產生測資並執行 benchmark ====="
+for n in $SIZES; do
+    prefix="$TESTCASE_DIR/synth_$n"
+    # 同樣的 cells 數與 seed 會產生相同的檔案，已存在就不重新產生
+    if [ ! -f "$prefix.def" ]; then
+        ../bin/hw3_gen "$prefix" "$n"
+    fi
+    echo "--- synth_$n ---"
+    ../bin/hw3_bench "$prefix.lef" "$prefix.def" --quick | tee "$OUTPUT_DIR/bench_$n.log"
+done
+
+echo "===== [3/3] 摘要 ====="
+for n in $SIZES; do
+    log="$OUTPUT_DIR/bench_$n.log"
+    parse=$(grep -m1 "Parsing & Preprocessing" "$log" | awk '{print $(NF-1)}')
+    initial=$(grep -m1 "Initial HPWL" "$log" | awk '{print $NF}')
+    final=$(grep -m1 "Final HPWL" "$log" | awk '{print $NF}')
+    passes=$(grep -E "^[A-Za-z]+(\([0-9]+\))? +[0-9.]+ ms" "$log" | awk '{t += $2} END {printf "%.0f", t}')
+    echo "cells=$n  parse=${parse}ms  passes=${passes}ms  initial_hpwl=$initial  final_hpwl=$final"
+done
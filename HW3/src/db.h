@@ -5,6 +5,26 @@
 #include <unordered_map>
 #include <map>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include "string_pool.h"
+
+// DEF orientations, one byte on Inst and Row so a move copies an integer
+// instead of a string. Input outside this set is rejected by the parser.
+enum class Orient : uint8_t { N, S, W, E, FN, FS, FW, FE };
+
+inline const char* orientName(Orient o) {
+    static const char* const kNames[] = {"N", "S", "W", "E", "FN", "FS", "FW", "FE"};
+    return kNames[(int)o];
+}
+
+inline bool parseOrient(StrRef s, Orient &o) {
+    for (int k = 0; k < 8; ++k) {
+        if (s == orientName((Orient)k)) { o = (Orient)k; return true; }
+    }
+    return false;
+}
 
 struct Macro {
     std::string name;
@@ -19,48 +39,159 @@ struct Site {
     int height_dbu = 0;
 };
 
+// Cells of one row ordered by (x, id). Each entry carries the x it was
+// filed under, so searches never go through db.instances; whoever moves a
+// cell must erase it under its old x and insert it under the new one, or
+// update it in place with setX() when the row order is unchanged.
+class RowCells {
+public:
+    struct Entry {
+        int x, id;
+        bool operator<(const Entry& o) const { return x != o.x ? x < o.x : id < o.id; }
+    };
+
+    size_t size() const { return v.size(); }
+    bool empty() const { return v.empty(); }
+    void clear() { v.clear(); }
+    const Entry* begin() const { return v.data(); }
+    const Entry* end() const { return v.data() + v.size(); }
+    int id(size_t k) const { return v[k].id; }
+    int x(size_t k) const { return v[k].x; }
+
+    // Replaces the contents with entries already in (x, id) order.
+    void assign(const Entry* first, const Entry* last) { v.assign(first, last); }
+
+    // Unordered append for bulk builds; call sort() afterwards.
+    void push_back(int x, int id) { v.push_back(Entry{x, id}); }
+    void sort() { std::sort(v.begin(), v.end()); }
+    bool isSorted() const { return std::is_sorted(v.begin(), v.end()); }
+
+    size_t insert(int x, int id) {
+        auto it = std::lower_bound(v.begin(), v.end(), Entry{x, id});
+        size_t k = it - v.begin();
+        v.insert(it, Entry{x, id});
+        return k;
+    }
+
+    // Removes id filed under x. Falls back to a scan if the key is stale.
+    void erase(int x, int id) {
+        auto it = std::lower_bound(v.begin(), v.end(), Entry{x, id});
+        if (it == v.end() || it->id != id) {
+            it = std::find_if(v.begin(), v.end(), [&](const Entry& e){ return e.id == id; });
+            if (it == v.end()) return;
+        }
+        v.erase(it);
+    }
+
+    // Index of the first entry with x >= x_query.
+    size_t lowerBound(int x_query) const {
+        return std::lower_bound(v.begin(), v.end(), Entry{x_query, std::numeric_limits<int>::min()}) - v.begin();
+    }
+
+    // Rewrites entry k; the caller keeps the row ordered.
+    void set(size_t k, int x, int id) { v[k] = Entry{x, id}; }
+    void setX(size_t k, int x) { v[k].x = x; }
+
+private:
+    std::vector<Entry> v;
+};
+
 struct Row {
     std::string name;
     std::string site_name;
     int x = 0, y = 0;        
     int site_count = 0;      
     int step_x = 0;          
-    std::string orient;      
-    std::vector<int> cell_ids; 
+    Orient orient = Orient::N;
+    RowCells cells; 
     std::vector<std::pair<int, int>> blockages;
 };
 
+// Placement state of one instance: everything move evaluation reads or
+// writes, 24 bytes with no heap members. Names are in db.inst_info.
 struct Inst {
-    std::string name;        
-    std::string macro_name;  
     int x = 0, y = 0;        
-    std::string orient;      
-    bool is_fixed = false;   
     int macro_width = 0;     
     int macro_height = 0;
     int row_id = -1;         
+    Orient orient = Orient::N;
+    bool is_fixed = false;   
+};
+
+// Names of an instance, indexed like db.instances; only parsing and
+// reporting touch these.
+struct InstInfo {
+    int name = -1;           // id into DesignDB::inst_names
+    int macro = -1;          // id into DesignDB::macro_names
 };
 
+// Names below are ids into DesignDB::names.
 struct NetPin {
     bool is_port = false;    
     int inst_id = -1;        
-    std::string pin_name;    
-    std::string port_name;   
+    int pin_name = -1;    
+    int port_name = -1;   
 };
 
 struct Net {
-    std::string name;
+    int name = -1;
     std::vector<NetPin> pins;
 };
 
 struct IOPin {
-    std::string name;
+    int name = -1;
     int x = 0;
     int y = 0;
     std::string orient;  
 };
 
 
+template <typename T>
+struct Span {
+    const T* first = nullptr;
+    const T* last = nullptr;
+
+    Span() {}
+    Span(const T* f, const T* l) : first(f), last(l) {}
+
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    size_t size() const { return (size_t)(last - first); }
+    bool empty() const { return first == last; }
+    const T& operator[](size_t i) const { return first[i]; }
+};
+
+// Id-only view of the netlist used by every HPWL path in the placer.
+// Built once after parsing (buildNetlistView), so no string lookups remain
+// in move evaluation.
+struct NetlistView {
+    // net -> pins (CSR). A pin ref >= 0 is an instance id, a ref < 0 is
+    // ~index into io_x / io_y. Unresolved pins are dropped at build time.
+    std::vector<uint32_t> net_pin_start;
+    std::vector<int32_t> pin_ref;
+    std::vector<int32_t> io_x, io_y;
+
+    // cell -> nets (CSR); each cell's list is sorted and duplicate-free.
+    std::vector<uint32_t> cell_net_start;
+    std::vector<uint32_t> cell_nets;
+
+    int numNets() const { return net_pin_start.empty() ? 0 : (int)net_pin_start.size() - 1; }
+
+    Span<int32_t> netPins(int net_id) const {
+        const int32_t* base = pin_ref.data();
+        return Span<int32_t>(base + net_pin_start[net_id], base + net_pin_start[net_id + 1]);
+    }
+
+    Span<uint32_t> cellNets(int inst_id) const {
+        const uint32_t* base = cell_nets.data();
+        return Span<uint32_t>(base + cell_net_start[inst_id], base + cell_net_start[inst_id + 1]);
+    }
+
+    int cellDegree(int inst_id) const {
+        return (int)(cell_net_start[inst_id + 1] - cell_net_start[inst_id]);
+    }
+};
+
 struct DesignDB {
     int lef_dbu_per_micron = 0;
     int def_dbu_per_micron = 0;
@@ -70,12 +201,31 @@ struct DesignDB {
 
     std::vector<Row> rows;
     std::vector<Inst> instances;
-    std::unordered_map<std::string, int> inst_name_to_id;
+    std::vector<InstInfo> inst_info;
+    StringPool inst_names;           // instance name -> name id
+    StringPool macro_names;          // macro name of any instance -> id
+    std::vector<int> inst_of_name;   // name id -> instance id
+
+    // Net, pin and I/O port names.
+    StringPool names;
 
     std::vector<Net> nets;
-    std::unordered_map<std::string, int> net_name_to_id;
 
-    std::unordered_map<std::string, IOPin> io_pins;
+    std::vector<IOPin> io_pins;
+    std::vector<int> io_pin_of_name; // names id -> io_pins index, -1 if none
+
+    // Where each "+ PLACED" location sits in the input DEF, so writeDEF can
+    // copy the file through and only rewrite these byte ranges.
+    struct DefPlacement { size_t begin, end; int inst_id; };
+    std::vector<DefPlacement> def_placements;  // in file order
+    size_t def_size = 0;
+
+    int findInst(StrRef name) const {
+        int id = inst_names.find(name);
+        return id < 0 ? -1 : inst_of_name[id];
+    }
+
+    NetlistView netlist;
 
     int core_site_width_dbu = 0; 
     double core_site_width_micron = 0.0; 
@@ -85,18 +235,16 @@ struct DesignDB {
 };
 
 
-struct Bin {
-    std::map<int, std::vector<int>> cells_by_width;
-    std::vector<int> all_cells_in_bin;
-};
-
+// Movable cells filed by position on a uniform grid of bins, stored
+// row-major in flat arrays. Each bin lists all of its cells and, per distinct
+// cell width, the cells of that width. Every cell remembers where it is
+// filed, so removing or refiling one swaps it with the last entry of each
+// list it is in instead of searching for it.
 class BinGrid {
 public:
-    int num_bins_x, num_bins_y;
-    int bin_width, bin_height;
-    int die_x_min, die_y_min;
-    
-    std::vector<std::vector<Bin>> bins; 
+    int num_bins_x = 0, num_bins_y = 0;
+    int bin_width = 1, bin_height = 1;
+    int die_x_min = 0, die_y_min = 0;
 
     void init(int die_x_max, int die_y_max, int nx, int ny) {
         num_bins_x = nx;
@@ -113,13 +261,12 @@ public:
         bin_height = (int)std::ceil((double)die_y_max / ny);
         if (bin_width == 0) bin_width = 1;
         if (bin_height == 0) bin_height = 1;
-        
-        bins.resize(num_bins_x, std::vector<Bin>(num_bins_y));
-        std::cout << "[BinGrid] Initialized " << nx << "x" << ny 
-                  << " grid (Bin size: " << bin_width << "x" << bin_height << " DBU)" << std::endl;
+
+        widths.clear();
+        clear();
     }
 
-    std::pair<int, int> getBinIndex(int x, int y) {
+    std::pair<int, int> getBinIndex(int x, int y) const {
         int idx_x = (x - die_x_min) / bin_width;
         int idx_y = (y - die_y_min) / bin_height;
         
@@ -130,41 +277,265 @@ public:
         return {idx_x, idx_y};
     }
 
+    int binOf(int x, int y) const {
+        auto b = getBinIndex(x, y);
+        return b.second * num_bins_x + b.first;
+    }
+
+    // Files every movable cell of db, replacing the previous contents.
+    void build(const DesignDB& db) {
+        widths.clear();
+        for (const auto& inst : db.instances) {
+            if (!inst.is_fixed) widths.push_back(inst.macro_width);
+        }
+        std::sort(widths.begin(), widths.end());
+        widths.erase(std::unique(widths.begin(), widths.end()), widths.end());
+        clear();
+        for (int i = 0; i < (int)db.instances.size(); ++i) {
+            if (!db.instances[i].is_fixed) addInstance(db.instances[i], i);
+        }
+    }
+
     void addInstance(const Inst& inst, int inst_id) {
-        auto indices = getBinIndex(inst.x, inst.y);
-        bins[indices.first][indices.second].cells_by_width[inst.macro_width].push_back(inst_id);
-        bins[indices.first][indices.second].all_cells_in_bin.push_back(inst_id);
+        if (inst_id >= (int)bin_of.size()) {
+            bin_of.resize(inst_id + 1, -1);
+            pos_all.resize(inst_id + 1, -1);
+            pos_width.resize(inst_id + 1, -1);
+            width_class.resize(inst_id + 1, -1);
+        }
+        if (bin_of[inst_id] >= 0) removeInstance(inst_id);
+        int cls = classOf(inst.macro_width);
+        int b = binOf(inst.x, inst.y);
+        std::vector<int>& cells = all[b];
+        std::vector<int>& same = by_width[(size_t)cls * all.size() + b];
+        bin_of[inst_id] = b;
+        width_class[inst_id] = cls;
+        pos_all[inst_id] = (int)cells.size();
+        pos_width[inst_id] = (int)same.size();
+        cells.push_back(inst_id);
+        same.push_back(inst_id);
     }
 
-    void removeInstance(const Inst& inst, int inst_id) {
-        auto indices = getBinIndex(inst.x, inst.y);
-        int width = inst.macro_width;
-        
-        if (bins[indices.first][indices.second].cells_by_width.count(width)) {
-            auto& candidates = bins[indices.first][indices.second].cells_by_width.at(width);
-            for (int i = 0; i < (int)candidates.size(); ++i) {
-                if (candidates[i] == inst_id) {
-                    candidates.erase(candidates.begin() + i);
-                    break;
-                }
+    void removeInstance(int inst_id) {
+        if (inst_id >= (int)bin_of.size() || bin_of[inst_id] < 0) return;
+        int b = bin_of[inst_id];
+        unlink(all[b], pos_all, inst_id);
+        unlink(by_width[(size_t)width_class[inst_id] * all.size() + b], pos_width, inst_id);
+        bin_of[inst_id] = -1;
+    }
+
+    // Refiles a cell after it moved; a move within its bin costs one lookup.
+    void update(const Inst& inst, int inst_id) {
+        if (inst_id < (int)bin_of.size() && bin_of[inst_id] == binOf(inst.x, inst.y)) return;
+        addInstance(inst, inst_id);
+    }
+
+    Span<int> cells(int bx, int by) const {
+        const std::vector<int>& v = all[by * num_bins_x + bx];
+        return Span<int>(v.data(), v.data() + v.size());
+    }
+
+    Span<int> cellsOfWidth(int bx, int by, int width) const {
+        int cls = findClass(width);
+        if (cls < 0) return Span<int>();
+        const std::vector<int>& v = by_width[(size_t)cls * all.size() + by * num_bins_x + bx];
+        return Span<int>(v.data(), v.data() + v.size());
+    }
+
+    void clear() {
+        // Lists are emptied rather than freed, so a rebuild reuses them.
+        all.resize((size_t)num_bins_x * num_bins_y);
+        by_width.resize(widths.size() * all.size());
+        for (auto& v : all) v.clear();
+        for (auto& v : by_width) v.clear();
+        bin_of.clear();
+        pos_all.clear();
+        pos_width.clear();
+        width_class.clear();
+    }
+
+private:
+    std::vector<std::vector<int>> all;        // bin -> cells
+    std::vector<std::vector<int>> by_width;   // (width class, bin) -> cells, class-major
+    std::vector<int> widths;                  // width class -> width
+    // Per cell: its bin (-1 if not filed), width class and index in each list.
+    std::vector<int> bin_of, width_class, pos_all, pos_width;
+
+    // A design has a handful of distinct widths, so a scan beats a map.
+    int findClass(int width) const {
+        for (size_t k = 0; k < widths.size(); ++k) {
+            if (widths[k] == width) return (int)k;
+        }
+        return -1;
+    }
+
+    // A width first seen after build() gets a new class, which appends one
+    // block of bins to by_width without moving the others.
+    int classOf(int width) {
+        int cls = findClass(width);
+        if (cls >= 0) return cls;
+        widths.push_back(width);
+        by_width.resize(widths.size() * all.size());
+        return (int)widths.size() - 1;
+    }
+
+    static void unlink(std::vector<int>& list, std::vector<int>& pos, int inst_id) {
+        int k = pos[inst_id];
+        int last = list.back();
+        list[k] = last;
+        pos[last] = k;
+        list.pop_back();
+        pos[inst_id] = -1;
+    }
+};
+
+// Rows sorted by y and grouped by height class, with each row's x span
+// precomputed. Built once per placement run, so assigning a cell to a row is
+// a binary search instead of a scan over every row.
+class RowIndex {
+public:
+    void build(const DesignDB& db, int site_width) {
+        int num_rows = (int)db.rows.size();
+        row_height.assign(num_rows, 0);
+        span_left.assign(num_rows, 0);
+        span_right.assign(num_rows, 0);
+        all_by_y.clear();
+        classes.clear();
+
+        for (int r = 0; r < num_rows; ++r) {
+            const Row& row = db.rows[r];
+            auto it = db.sites.find(row.site_name);
+            if (it != db.sites.end()) row_height[r] = it->second.height_dbu;
+            span_left[r] = row.x;
+            span_right[r] = row.x + (long long)row.site_count * site_width;
+            all_by_y.push_back({row.y, r});
+
+            int c = 0;
+            while (c < (int)classes.size() && classes[c].height != row_height[r]) ++c;
+            if (c == (int)classes.size()) {
+                classes.push_back(HeightClass());
+                classes.back().height = row_height[r];
+                classes.back().min_left = span_left[r];
+                classes.back().max_right = span_right[r];
             }
+            HeightClass& hc = classes[c];
+            hc.rows.push_back({row.y, r});
+            hc.min_left = std::min(hc.min_left, span_left[r]);
+            hc.max_right = std::max(hc.max_right, span_right[r]);
         }
-        
-        auto& all_candidates = bins[indices.first][indices.second].all_cells_in_bin;
-        for (int i = 0; i < (int)all_candidates.size(); ++i) {
-            if (all_candidates[i] == inst_id) {
-                all_candidates.erase(all_candidates.begin() + i);
-                break;
+
+        std::sort(all_by_y.begin(), all_by_y.end());
+        for (auto& hc : classes) std::sort(hc.rows.begin(), hc.rows.end());
+    }
+
+    int height(int row_id) const { return row_height[row_id]; }
+    long long spanLeft(int row_id) const { return span_left[row_id]; }
+    long long spanRight(int row_id) const { return span_right[row_id]; }
+
+    // Row for a cell of the given size at (x, y): the nearest row in y whose
+    // span holds [x, x + width), else the nearest row of a compatible height.
+    // Ties go to the lower row id; rows of unknown height fit any cell.
+    // Returns -1 if no row is compatible.
+    int findRow(int x, int y, int width, int height) const {
+        Best best;
+        for (const auto& hc : classes) {
+            if (hc.height > 0 && hc.height != height) continue;
+            searchClass(hc, x, y, width, best);
+        }
+        return best.row;
+    }
+
+    // Calls f(row_id, dy) for every row that fits a cell of the given height,
+    // in order of increasing dy = |row.y - y|, until f returns false.
+    template <typename F>
+    void forEachRowByDistance(int y, int height, F f) const {
+        // Heights are unique per class, so at most the exact class and the
+        // unknown-height class qualify.
+        struct Cursor { const std::vector<Entry>* v; int lo, hi; };
+        Cursor cur[2];
+        int num = 0;
+        for (const auto& hc : classes) {
+            if (hc.height > 0 && hc.height != height) continue;
+            int hi = (int)(std::lower_bound(hc.rows.begin(), hc.rows.end(), Entry{y, -1}) - hc.rows.begin());
+            cur[num++] = Cursor{&hc.rows, hi - 1, hi};
+            if (num == 2) break;
+        }
+        for (;;) {
+            Cursor* pick = nullptr;
+            bool lower = false;
+            long long best_d = 0;
+            for (int c = 0; c < num; ++c) {
+                const std::vector<Entry>& v = *cur[c].v;
+                if (cur[c].lo >= 0) {
+                    long long d = (long long)y - v[cur[c].lo].y;
+                    if (!pick || d < best_d) { pick = &cur[c]; lower = true; best_d = d; }
+                }
+                if (cur[c].hi < (int)v.size()) {
+                    long long d = (long long)v[cur[c].hi].y - y;
+                    if (!pick || d < best_d) { pick = &cur[c]; lower = false; best_d = d; }
+                }
             }
+            if (!pick) return;
+            int r = lower ? (*pick->v)[pick->lo--].row_id : (*pick->v)[pick->hi++].row_id;
+            if (!f(r, best_d)) return;
         }
     }
 
-    void clear() {
-        for (int i = 0; i < num_bins_x; ++i) {
-            for (int j = 0; j < num_bins_y; ++j) {
-                bins[i][j].cells_by_width.clear();
-                bins[i][j].all_cells_in_bin.clear(); 
+    // Calls f(row_id) for every row with y_lo <= row.y <= y_hi, in y order.
+    template <typename F>
+    void forEachRowInY(int y_lo, int y_hi, F f) const {
+        auto it = std::lower_bound(all_by_y.begin(), all_by_y.end(), Entry{y_lo, -1});
+        for (; it != all_by_y.end() && it->y <= y_hi; ++it) f(it->row_id);
+    }
+
+private:
+    struct Entry {
+        int y;
+        int row_id;
+        bool operator<(const Entry& o) const { return y != o.y ? y < o.y : row_id < o.row_id; }
+    };
+
+    struct HeightClass {
+        int height = 0;
+        std::vector<Entry> rows;
+        long long min_left = 0, max_right = 0;
+    };
+
+    struct Best {
+        int row = -1;
+        int dy = 0;
+        bool in_span = false;
+
+        void offer(int row_id, int d, bool span) {
+            if (row >= 0) {
+                if (in_span && !span) return;
+                if (in_span == span && (d > dy || (d == dy && row_id > row))) return;
             }
+            row = row_id; dy = d; in_span = span;
+        }
+    };
+
+    // Walks outward from y in order of increasing |dy| and stops once no
+    // remaining row of this class can beat the current best.
+    void searchClass(const HeightClass& hc, int x, int y, int width, Best& best) const {
+        const std::vector<Entry>& v = hc.rows;
+        bool may_span = x >= hc.min_left && (long long)x + width <= hc.max_right;
+        int hi = (int)(std::lower_bound(v.begin(), v.end(), Entry{y, -1}) - v.begin());
+        int lo = hi - 1;
+        while (lo >= 0 || hi < (int)v.size()) {
+            int d_lo = lo >= 0 ? y - v[lo].y : std::numeric_limits<int>::max();
+            int d_hi = hi < (int)v.size() ? v[hi].y - y : std::numeric_limits<int>::max();
+            int idx = (d_lo <= d_hi) ? lo-- : hi++;
+            int d = std::min(d_lo, d_hi);
+            if (best.row >= 0 && d > best.dy && (best.in_span || !may_span)) break;
+            int r = v[idx].row_id;
+            bool span = x >= span_left[r] && (long long)x + width <= span_right[r];
+            best.offer(r, d, span);
         }
     }
-};
\ No newline at end of file
+
+    std::vector<HeightClass> classes;
+    std::vector<Entry> all_by_y;
+    std::vector<int> row_height;
+    std::vector<long long> span_left, span_right;
+};
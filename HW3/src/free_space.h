@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Free-site index of one row. Occupancy is kept as a per-site count (cells
+// may overlap in the input) and a bitmap of free sites in 64-site words. A
+// segment tree over the words stores, per node, the longest free run and the
+// free runs touching its left and right edges, so "nearest free run of at
+// least w sites to site s" is answered in O(log n) and occupy/release cost
+// O(w + log n). Site s corresponds to x = row.x + s * site_width.
+class RowFreeSpace {
+public:
+    void init(int num_sites) {
+        n = std::max(num_sites, 0);
+        words = std::max(1, (n + 63) / 64);
+        leaves = 1;
+        while (leaves < words) leaves <<= 1;
+        count.assign(n, 0);
+        bits.assign(words, ~0ULL);
+        if (n % 64) bits[words - 1] = (1ULL << (n % 64)) - 1;
+        if (n == 0) bits[0] = 0;
+        tree.assign(2 * leaves, Node());
+        for (int w = 0; w < leaves; ++w) tree[leaves + w] = leafNode(w);
+        for (int i = leaves - 1; i >= 1; --i) tree[i] = merge(tree[2 * i], tree[2 * i + 1]);
+    }
+
+    int numSites() const { return n; }
+
+    void occupy(int s0, int s1) { update(s0, s1, +1); }
+    void release(int s0, int s1) { update(s0, s1, -1); }
+
+    // Smallest start >= from with [start, start + w) free, or -1.
+    int findFirstFit(int from, int w) const {
+        from = std::max(from, 0);
+        if (w <= 0 || from + w > n || tree[1].best < w) return -1;
+        int carry = 0;
+        return firstFit(1, 0, leaves * 64, from, w, carry);
+    }
+
+    // Largest start <= from with [start, start + w) free, or -1.
+    int findLastFit(int from, int w) const {
+        if (w <= 0 || from < 0 || tree[1].best < w) return -1;
+        int limit = std::min(from + w, n);
+        int carry = 0;
+        return lastFit(1, 0, leaves * 64, limit, w, carry);
+    }
+
+private:
+    struct Node {
+        int pre = 0, suf = 0, best = 0, len = 0;
+    };
+
+    int n = 0, words = 0, leaves = 1;
+    std::vector<uint16_t> count;
+    std::vector<uint64_t> bits;
+    std::vector<Node> tree;
+
+    static int longestRun(uint64_t x) {
+        int run = 0;
+        while (x) { x &= x << 1; ++run; }
+        return run;
+    }
+
+    Node leafNode(int w) const {
+        Node nd;
+        nd.len = 64;
+        if (w >= words) return nd;
+        uint64_t x = bits[w];
+        nd.pre = (x == ~0ULL) ? 64 : __builtin_ctzll(~x);
+        nd.suf = (x == ~0ULL) ? 64 : __builtin_clzll(~x);
+        nd.best = longestRun(x);
+        return nd;
+    }
+
+    static Node merge(const Node& a, const Node& b) {
+        Node nd;
+        nd.len = a.len + b.len;
+        nd.pre = (a.pre == a.len) ? a.len + b.pre : a.pre;
+        nd.suf = (b.suf == b.len) ? b.len + a.suf : b.suf;
+        nd.best = std::max(std::max(a.best, b.best), a.suf + b.pre);
+        return nd;
+    }
+
+    void update(int s0, int s1, int delta) {
+        s0 = std::max(s0, 0);
+        s1 = std::min(s1, n);
+        if (s0 >= s1) return;
+        for (int s = s0; s < s1; ++s) {
+            if (delta > 0) {
+                if (count[s]++ == 0) bits[s >> 6] &= ~(1ULL << (s & 63));
+            } else if (count[s] > 0) {
+                if (--count[s] == 0) bits[s >> 6] |= 1ULL << (s & 63);
+            }
+        }
+        for (int w = s0 >> 6; w <= (s1 - 1) >> 6; ++w) {
+            int i = leaves + w;
+            tree[i] = leafNode(w);
+            for (i >>= 1; i >= 1; i >>= 1) tree[i] = merge(tree[2 * i], tree[2 * i + 1]);
+        }
+    }
+
+    bool siteFree(int s) const { return s < n && ((bits[s >> 6] >> (s & 63)) & 1ULL); }
+
+    // carry = length of the free run (sites >= from) ending just before lo.
+    int firstFit(int node, int lo, int hi, int from, int w, int& carry) const {
+        if (hi <= from) return -1;
+        const Node& nd = tree[node];
+        if (lo >= from) {
+            if (carry + nd.pre >= w) return lo - carry;
+            if (nd.best < w) {
+                carry = (nd.pre == nd.len) ? carry + nd.len : nd.suf;
+                return -1;
+            }
+        }
+        if (node >= leaves) {
+            for (int s = std::max(lo, from); s < hi; ++s) {
+                if (siteFree(s)) {
+                    if (++carry >= w) return s - w + 1;
+                } else {
+                    carry = 0;
+                }
+            }
+            return -1;
+        }
+        int mid = (lo + hi) / 2;
+        int r = firstFit(2 * node, lo, mid, from, w, carry);
+        if (r >= 0) return r;
+        return firstFit(2 * node + 1, mid, hi, from, w, carry);
+    }
+
+    // carry = length of the free run (sites < limit) starting just at hi.
+    int lastFit(int node, int lo, int hi, int limit, int w, int& carry) const {
+        if (lo >= limit) return -1;
+        const Node& nd = tree[node];
+        if (hi <= limit) {
+            if (carry + nd.suf >= w) return hi + carry - w;
+            if (nd.best < w) {
+                carry = (nd.suf == nd.len) ? carry + nd.len : nd.pre;
+                return -1;
+            }
+        }
+        if (node >= leaves) {
+            for (int s = std::min(hi, limit) - 1; s >= lo; --s) {
+                if (siteFree(s)) {
+                    if (++carry >= w) return s;
+                } else {
+                    carry = 0;
+                }
+            }
+            return -1;
+        }
+        int mid = (lo + hi) / 2;
+        int r = lastFit(2 * node + 1, mid, hi, limit, w, carry);
+        if (r >= 0) return r;
+        return lastFit(2 * node, lo, mid, limit, w, carry);
+    }
+};
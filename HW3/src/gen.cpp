@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic LEF/DEF for placer benchmarks. The LEF has one core site and a
+// handful of standard cells of different widths plus a block macro; the DEF
+// has rows over a square die, fixed blocks, I/O pins on the die edge, legal
+// but randomly assigned cell positions, and a hierarchical netlist that
+// follows Rent's rule. Output depends only on the options and the seed.
+
+struct GenConfig {
+    long long cells = 0;
+    double util = 0.7;           // cell area / free row area
+    int blocks = 4;
+    int io_pins = 200;
+    double rent_p = 0.65;        // Rent exponent
+    double nets_per_cell = 1.1;
+    uint64_t seed = 1;
+};
+
+static const int kDbu = 2000;
+static const int kSiteW = 200;      // 0.1 um
+static const int kRowH = 2400;      // 1.2 um
+static const int kWidths[] = {2, 3, 4, 5, 6, 8};  // in sites
+static const int kNumWidths = sizeof(kWidths) / sizeof(kWidths[0]);
+static const int kBlockSites = 200; // 20 um
+static const int kBlockRows = 10;   // 12 um
+
+// Net degrees and their relative weights; most nets are two- and three-pin.
+static const int kDegrees[] = {2, 3, 4, 5, 6, 8, 12, 20, 40};
+static const int kDegreeWeights[] = {50, 20, 10, 6, 4, 4, 3, 2, 1};
+
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : gen(seed) {}
+    // Uniform in [0, n).
+    long long below(long long n) { return n <= 1 ? 0 : (long long)(gen() % (uint64_t)n); }
+    double unit() { return (gen() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    std::mt19937_64 gen;
+};
+
+static FILE* openOutput(const std::string& path, std::vector<char>& buf) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        std::cerr << "Error: Cannot open " << path << " for writing" << std::endl;
+        exit(1);
+    }
+    buf.resize(1 << 20);
+    setvbuf(f, buf.data(), _IOFBF, buf.size());
+    return f;
+}
+
+static void closeOutput(FILE* f, const std::string& path) {
+    bool ok = !std::ferror(f);
+    if (std::fclose(f) != 0) ok = false;
+    if (!ok) {
+        std::cerr << "Error: Failed writing " << path << std::endl;
+        exit(1);
+    }
+}
+
+static void writeLef(const std::string& path) {
+    std::vector<char> buf;
+    FILE* f = openOutput(path, buf);
+    std::fprintf(f, "VERSION 5.8 ;\nBUSBITCHARS \"[]\" ;\nDIVIDERCHAR \"/\" ;\n\n");
+    std::fprintf(f, "UNITS\n  DATABASE MICRONS %d ;\nEND UNITS\n\n", kDbu);
+    std::fprintf(f, "SITE CoreSite\n  CLASS CORE ;\n  SYMMETRY Y ;\n  SIZE %.1f BY %.1f ;\nEND CoreSite\n\n",
+                 (double)kSiteW / kDbu, (double)kRowH / kDbu);
+    for (int w : kWidths) {
+        std::fprintf(f, "MACRO C%d\n  CLASS CORE ;\n  ORIGIN 0 0 ;\n  SIZE %.1f BY %.1f ;\n"
+                        "  SYMMETRY X Y ;\n  SITE CoreSite ;\n"
+                        "  PIN A\n    DIRECTION INPUT ;\n  END A\n"
+                        "  PIN Y\n    DIRECTION OUTPUT ;\n  END Y\nEND C%d\n\n",
+                     w, (double)w * kSiteW / kDbu, (double)kRowH / kDbu, w);
+    }
+    std::fprintf(f, "MACRO BLK\n  CLASS BLOCK ;\n  ORIGIN 0 0 ;\n  SIZE %.1f BY %.1f ;\n"
+                    "  PIN A\n    DIRECTION INPUT ;\n  END A\nEND BLK\n\nEND LIBRARY\n",
+                 (double)kBlockSites * kSiteW / kDbu, (double)kBlockRows * kRowH / kDbu);
+    closeOutput(f, path);
+}
+
+// Every range [lo, hi) of two or more cells in a binary split of the cell
+// order owns about alpha * n^p nets whose pins are drawn from the whole
+// range, at least one in each half. A range of n cells then sees on the
+// order of n^p nets leave it, which is Rent's rule with exponent p. The
+// fractional parts are carried in visit order, so the counting pass and the
+// writing pass agree exactly.
+class RentNetlist {
+public:
+    RentNetlist(long long cells, double p, double nets) : n(cells), p(p) {
+        double total = weight(n);
+        alpha = total > 0 ? nets / total : 0.0;
+    }
+
+    long long count() {
+        long long c = 0;
+        auto add = [&](long long, long long, long long k) { c += k; };
+        carry = 0.0;
+        visit(0, n, add);
+        return c;
+    }
+
+    // Calls emit(lo, hi, k) for each range, k nets each.
+    template <typename Emit>
+    void forEach(Emit emit) {
+        carry = 0.0;
+        visit(0, n, emit);
+    }
+
+private:
+    long long n;
+    double p, alpha = 0.0, carry = 0.0;
+
+    std::map<long long, double> weights;
+
+    // Sum of m^p over all ranges of a range of m cells. A level of the split
+    // has at most two distinct range sizes, so memoizing keeps this O(log n).
+    double weight(long long m) {
+        if (m < 2) return 0.0;
+        auto it = weights.find(m);
+        if (it != weights.end()) return it->second;
+        long long left = m / 2;
+        double w = std::pow((double)m, p) + weight(left) + weight(m - left);
+        weights[m] = w;
+        return w;
+    }
+
+    template <typename Emit>
+    void visit(long long lo, long long hi, Emit& emit) {
+        long long m = hi - lo;
+        if (m < 2) return;
+        double want = alpha * std::pow((double)m, p) + carry;
+        long long k = (long long)want;
+        carry = want - k;
+        if (k > 0) emit(lo, hi, k);
+        long long mid = lo + m / 2;
+        visit(lo, mid, emit);
+        visit(mid, hi, emit);
+    }
+};
+
+static int pickDegree(Rng& rng) {
+    int total = 0;
+    for (int w : kDegreeWeights) total += w;
+    int r = (int)rng.below(total);
+    for (size_t i = 0; i < sizeof(kDegrees) / sizeof(kDegrees[0]); ++i) {
+        if (r < kDegreeWeights[i]) return kDegrees[i];
+        r -= kDegreeWeights[i];
+    }
+    return 2;
+}
+
+struct Block { int x, y; };
+
+static void writeDef(const std::string& path, const std::string& design, const GenConfig& cfg) {
+    Rng rng(cfg.seed);
+    long long n = cfg.cells;
+
+    std::vector<uint8_t> width(n);
+    long long total_sites = 0;
+    for (long long i = 0; i < n; ++i) {
+        width[i] = (uint8_t)kWidths[rng.below(kNumWidths)];
+        total_sites += width[i];
+    }
+
+    // Square die holding the cells at the target utilization plus the blocks.
+    double area = (double)total_sites * kSiteW * kRowH / cfg.util
+                + (double)cfg.blocks * kBlockSites * kSiteW * kBlockRows * kRowH;
+    double side = std::sqrt(area);
+    int rows = std::max(1, (int)std::ceil(side / kRowH));
+    int sites = std::max(kWidths[kNumWidths - 1], (int)std::ceil(area / ((double)rows * kRowH * kSiteW)));
+
+    std::vector<Block> blocks;
+    for (int b = 0, tries = 0; b < cfg.blocks && tries < 1000 * (cfg.blocks + 1); ++tries) {
+        if (sites < kBlockSites || rows < kBlockRows) break;
+        Block cand{(int)rng.below(sites - kBlockSites + 1), (int)rng.below(rows - kBlockRows + 1)};
+        bool clash = false;
+        for (const Block& o : blocks)
+            if (cand.x < o.x + kBlockSites && o.x < cand.x + kBlockSites &&
+                cand.y < o.y + kBlockRows && o.y < cand.y + kBlockRows) clash = true;
+        if (clash) continue;
+        blocks.push_back(cand);
+        ++b;
+    }
+    if ((int)blocks.size() < cfg.blocks)
+        std::cerr << "[Gen] Placed " << blocks.size() << " of " << cfg.blocks << " blocks" << std::endl;
+
+    // Free sites after blocks and the worst-case waste at every row end and
+    // in front of every block, spread as gaps between cells.
+    long long capacity = (long long)rows * sites - (long long)blocks.size() * kBlockSites * kBlockRows;
+    long long waste = (long long)(rows + blocks.size() * kBlockRows) * kWidths[kNumWidths - 1];
+    double gap_mean = std::max(0.0, (double)(capacity - total_sites - waste) / std::max(1LL, n));
+
+    // Cells are dealt onto the rows in random order, so the netlist order
+    // (which the nets follow) has nothing to do with the starting placement.
+    std::vector<int> order(n);
+    for (long long i = 0; i < n; ++i) order[i] = (int)i;
+    for (long long i = n - 1; i > 0; --i) std::swap(order[i], order[rng.below(i + 1)]);
+
+    std::vector<int> pos_x(n), pos_row(n);
+    long long next = 0;
+    double gap_budget = 0.0;
+    for (int r = 0; r < rows && next < n; ++r) {
+        std::vector<std::pair<int, int>> blocked;
+        for (const Block& b : blocks)
+            if (r >= b.y && r < b.y + kBlockRows) blocked.push_back(std::make_pair(b.x, b.x + kBlockSites));
+        std::sort(blocked.begin(), blocked.end());
+        int x = 0;
+        while (next < n) {
+            gap_budget += gap_mean;
+            int gap = (int)std::min(gap_budget, rng.unit() * 2.0 * gap_mean);
+            gap_budget -= gap;
+            x += gap;
+            int id = order[next], w = width[id];
+            for (const auto& b : blocked)
+                if (x < b.second && x + w > b.first) x = b.second;
+            if (x + w > sites) break;
+            pos_x[id] = x;
+            pos_row[id] = r;
+            x += w;
+            ++next;
+        }
+    }
+    if (next < n) {
+        std::cerr << "Error: " << n - next << " cells did not fit; lower --util" << std::endl;
+        exit(1);
+    }
+
+    std::vector<char> buf;
+    FILE* f = openOutput(path, buf);
+    std::fprintf(f, "VERSION 5.8 ;\nDIVIDERCHAR \"/\" ;\nBUSBITCHARS \"[]\" ;\nDESIGN %s ;\n", design.c_str());
+    std::fprintf(f, "UNITS DISTANCE MICRONS %d ;\n\n", kDbu);
+    std::fprintf(f, "DIEAREA ( 0 0 ) ( %lld %lld ) ;\n\n", (long long)sites * kSiteW, (long long)rows * kRowH);
+    for (int r = 0; r < rows; ++r)
+        std::fprintf(f, "ROW ROW_%d CoreSite 0 %lld %s DO %d BY 1 STEP %d 0 ;\n",
+                     r, (long long)r * kRowH, (r & 1) ? "FS" : "N", sites, kSiteW);
+
+    std::fprintf(f, "\nCOMPONENTS %lld ;\n", n + (long long)blocks.size());
+    for (long long i = 0; i < n; ++i)
+        std::fprintf(f, "- c%lld C%d + PLACED ( %lld %lld ) %s ;\n", i, width[i],
+                     (long long)pos_x[i] * kSiteW, (long long)pos_row[i] * kRowH, (pos_row[i] & 1) ? "FS" : "N");
+    for (size_t b = 0; b < blocks.size(); ++b)
+        std::fprintf(f, "- blk%zu BLK + FIXED ( %lld %lld ) N ;\n", b,
+                     (long long)blocks[b].x * kSiteW, (long long)blocks[b].y * kRowH);
+    std::fprintf(f, "END COMPONENTS\n\n");
+
+    long long die_w = (long long)sites * kSiteW, die_h = (long long)rows * kRowH;
+    std::fprintf(f, "PINS %d ;\n", cfg.io_pins);
+    for (int p = 0; p < cfg.io_pins; ++p) {
+        long long x, y;
+        switch (p % 4) {
+            case 0: x = rng.below(die_w); y = 0; break;
+            case 1: x = rng.below(die_w); y = die_h; break;
+            case 2: x = 0; y = rng.below(die_h); break;
+            default: x = die_w; y = rng.below(die_h); break;
+        }
+        std::fprintf(f, "- p%d + NET io%d + DIRECTION %s + USE SIGNAL\n"
+                        "  + LAYER M2 ( -50 0 ) ( 50 100 )\n  + PLACED ( %lld %lld ) N ;\n",
+                     p, p, (p & 1) ? "OUTPUT" : "INPUT", x, y);
+    }
+    std::fprintf(f, "END PINS\n\n");
+
+    // Each I/O pin drives one or two cells near its share of the cell order.
+    long long io_nets = n > 0 ? cfg.io_pins : 0;
+    double target = std::max(0.0, cfg.nets_per_cell * n - io_nets);
+    RentNetlist rent(n, cfg.rent_p, target);
+    long long rent_nets = rent.count();
+
+    std::fprintf(f, "NETS %lld ;\n", rent_nets + io_nets);
+    for (long long p = 0; p < io_nets; ++p) {
+        long long c = p * n / io_nets;
+        std::fprintf(f, "- io%lld ( PIN p%lld ) ( c%lld A )", p, p, c);
+        if (c + 1 < n && rng.below(2)) std::fprintf(f, " ( c%lld A )", c + 1);
+        std::fprintf(f, " ;\n");
+    }
+    long long net_id = 0;
+    std::vector<long long> pins;
+    rent.forEach([&](long long lo, long long hi, long long k) {
+        long long m = hi - lo, mid = lo + m / 2;
+        for (long long j = 0; j < k; ++j) {
+            int d = (int)std::min<long long>(pickDegree(rng), m);
+            pins.clear();
+            pins.push_back(lo + rng.below(mid - lo));
+            pins.push_back(mid + rng.below(hi - mid));
+            for (int tries = 0; (int)pins.size() < d && tries < 4 * d; ++tries) {
+                long long c = lo + rng.below(m);
+                if (std::find(pins.begin(), pins.end(), c) == pins.end()) pins.push_back(c);
+            }
+            std::fprintf(f, "- n%lld", net_id++);
+            for (size_t q = 0; q < pins.size(); ++q) {
+                if (q > 0 && q % 4 == 0) std::fprintf(f, "\n ");
+                std::fprintf(f, " ( c%lld %s )", pins[q], q == 0 ? "Y" : "A");
+            }
+            std::fprintf(f, " ;\n");
+        }
+    });
+    std::fprintf(f, "END NETS\n\nEND DESIGN\n");
+    closeOutput(f, path);
+
+    std::cout << "[Gen] " << path << ": " << n << " cells, " << blocks.size() << " blocks, "
+              << rows << " rows x " << sites << " sites, " << cfg.io_pins << " I/O pins, "
+              << rent_nets + io_nets << " nets" << std::endl;
+}
+
+/*
+./../bin/hw3_gen ../testcase/synth100k 100000
+*/
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: ./hw3_gen <out_prefix> <num_cells> [--util <0-1>] [--blocks <n>] "
+                     "[--io-pins <n>] [--rent <p>] [--nets-per-cell <k>] [--seed <n>]\n";
+        return 1;
+    }
+    std::string prefix = argv[1];
+    GenConfig cfg;
+    cfg.cells = std::atoll(argv[2]);
+    for (int a = 3; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return 1;
+        }
+        const char* v = argv[++a];
+        if (arg == "--util") cfg.util = std::atof(v);
+        else if (arg == "--blocks") cfg.blocks = std::atoi(v);
+        else if (arg == "--io-pins") cfg.io_pins = std::atoi(v);
+        else if (arg == "--rent") cfg.rent_p = std::atof(v);
+        else if (arg == "--nets-per-cell") cfg.nets_per_cell = std::atof(v);
+        else if (arg == "--seed") cfg.seed = std::strtoull(v, nullptr, 10);
+        else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (cfg.cells < 1 || cfg.cells > 100000000LL || cfg.util <= 0.0 || cfg.util > 0.95 ||
+        cfg.blocks < 0 || cfg.io_pins < 0 || cfg.rent_p <= 0.0 || cfg.rent_p >= 1.0 || cfg.nets_per_cell < 0.0) {
+        std::cerr << "Invalid option value\n";
+        return 1;
+    }
+
+    std::string design = prefix.substr(prefix.find_last_of('/') + 1);
+    writeLef(prefix + ".lef");
+    writeDef(prefix + ".def", design, cfg);
+    return 0;
+}
@@ -0,0 +1,442 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "db.h"
+#include "thread_pool.h"
+
+struct GlobalPlaceStats {
+    int iterations = 0;
+    int cg_iterations = 0;     // summed over both axes and all iterations
+    double overflow = 0.0;     // of the last solved placement, fraction of cell area
+    // Filled in by Placer::runGlobalPlacement.
+    long long hpwl_before = 0, hpwl_after = 0;
+    bool kept = false;
+};
+
+// Quadratic global placement: the bound-to-bound net model of Kraftwerk2
+// (Spindler, Schlichtmann and Johannes, TCAD 2008), spread for density by
+// the recursive-bisection lookahead legalization of SimPL (Kim, Lee and
+// Markov, ICCAD 2010).
+//
+// Each iteration linearizes HPWL at the current positions. For a net of p
+// pins, the two extreme pins on an axis are tied to each other and to
+// every other pin with weight 2 / ((p - 1) * distance), so the quadratic
+// wirelength equals HPWL there. Each axis is then a sparse SPD system,
+// solved by Jacobi-preconditioned conjugate gradient warm-started from the
+// current positions; its matrix-vector and dot products run on the pool
+// over a fixed chunking, so results do not depend on the thread count.
+//
+// The solution is then spread. The bin grid is cut in half recursively
+// across the longer side, and the cells are split in coordinate order so
+// that neither side holds more than the target density of its free area.
+// Inside a single bin the cells are shifted or scaled to fit. The spread
+// positions anchor the next solve, with a weight that grows every
+// iteration, until the overflow of the solved placement drops to the
+// target. Cell origins are written back to db.instances; the result is
+// meant to be legalized afterwards.
+class GlobalPlacer {
+public:
+    GlobalPlacer(DesignDB& database, ThreadPool& thread_pool, int site_width)
+        : db(database), nl(database.netlist), pool(thread_pool), min_dist(std::max(site_width, 1)) {
+        for (int i = 0; i < (int)db.instances.size(); ++i) {
+            if (!db.instances[i].is_fixed) cells.push_back(i);
+        }
+        mov.assign(db.instances.size(), -1);
+        for (int k = 0; k < (int)cells.size(); ++k) mov[cells[k]] = k;
+        buildBins();
+    }
+
+    // Stops after max_iters iterations, once the overflow is at most
+    // target_overflow, or when stop() returns true (checked between
+    // iterations).
+    template <typename Stop>
+    GlobalPlaceStats run(int max_iters, double target_overflow, Stop stop) {
+        GlobalPlaceStats stats;
+        const int n = (int)cells.size();
+        if (n == 0) return stats;
+        pos[0].resize(n); pos[1].resize(n);
+        anchor[0].resize(n); anchor[1].resize(n);
+        center[0].resize(n); center[1].resize(n);
+        for (int k = 0; k < n; ++k) {
+            pos[0][k] = db.instances[cells[k]].x;
+            pos[1][k] = db.instances[cells[k]].y;
+        }
+        anchor[0] = pos[0];
+        anchor[1] = pos[1];
+
+        double anchor_scale = 0.0;
+        for (int it = 0; it < max_iters; ++it) {
+            if (it > 0 && stop()) break;
+            for (int axis = 0; axis < 2; ++axis) {
+                buildSystem(axis, anchor_scale);
+                stats.cg_iterations += solve(pos[axis], kCgIterations, 1e-5);
+            }
+            stats.iterations = it + 1;
+            stats.overflow = spread();
+            if (stats.overflow <= target_overflow) break;
+            anchor_scale = anchor_scale == 0.0 ? kFirstAnchor : anchor_scale * kAnchorGrowth;
+        }
+
+        // The spread positions, not the solved ones, go to legalization.
+        for (int k = 0; k < n; ++k) {
+            Inst& inst = db.instances[cells[k]];
+            inst.x = (int)std::llround(anchor[0][k]);
+            inst.y = (int)std::llround(anchor[1][k]);
+        }
+        return stats;
+    }
+
+private:
+    const int kCgIterations = 60;
+    const double kFirstAnchor = 0.02;   // anchor weight relative to the cell's net weight
+    const double kAnchorGrowth = 1.4;
+    const double kRegularization = 1e-4;
+    const double kTargetDensity = 0.9;  // bin fill allowed when spreading, unless the design is fuller
+    const int kChunk = 4096;
+
+    DesignDB& db;
+    const NetlistView& nl;
+    ThreadPool& pool;
+    const int min_dist;
+
+    std::vector<int> cells;         // movable index -> instance id
+    std::vector<int> mov;           // instance id -> movable index, -1 if fixed
+    std::vector<double> pos[2], anchor[2];
+
+    // System of the axis being solved: off-diagonal CSR plus diagonal and rhs.
+    struct Edge { int a, b; double w; };
+    std::vector<Edge> edges;
+    std::vector<uint32_t> row_start;
+    std::vector<int> col;
+    std::vector<double> val, diag, rhs;
+    std::vector<double> r, z, p, ap, partial;
+
+    // Bins for spreading; capacity is free row area.
+    int nbx = 1, nby = 1;
+    double bin_w = 1.0, bin_h = 1.0;
+    std::vector<double> cap, area, cap_sum;   // cap_sum: 2D prefix sums of cap
+    std::vector<double> center[2], prefix;
+    std::vector<int> order;
+
+    double coord(int32_t ref, int axis) const {
+        if (ref >= 0) {
+            int m = mov[ref];
+            if (m >= 0) return pos[axis][m];
+            return axis == 0 ? db.instances[ref].x : db.instances[ref].y;
+        }
+        return axis == 0 ? nl.io_x[~ref] : nl.io_y[~ref];
+    }
+
+    void connect(int32_t a, int32_t b, double w, int axis) {
+        int ma = a >= 0 ? mov[a] : -1;
+        int mb = b >= 0 ? mov[b] : -1;
+        if (ma >= 0 && mb >= 0) {
+            if (ma == mb) return;
+            diag[ma] += w; diag[mb] += w;
+            edges.push_back(Edge{ma, mb, w});
+        } else if (ma >= 0) {
+            diag[ma] += w; rhs[ma] += w * coord(b, axis);
+        } else if (mb >= 0) {
+            diag[mb] += w; rhs[mb] += w * coord(a, axis);
+        }
+    }
+
+    void buildSystem(int axis, double anchor_scale) {
+        const int n = (int)cells.size();
+        edges.clear();
+        diag.assign(n, 0.0);
+        rhs.assign(n, 0.0);
+        for (int net = 0; net < nl.numNets(); ++net) {
+            Span<int32_t> pins = nl.netPins(net);
+            const int deg = (int)pins.size();
+            if (deg < 2) continue;
+            int lo = 0, hi = 0;
+            for (int k = 1; k < deg; ++k) {
+                double c = coord(pins[k], axis);
+                if (c < coord(pins[lo], axis)) lo = k;
+                if (c >= coord(pins[hi], axis)) hi = k;
+            }
+            if (lo == hi) hi = lo == 0 ? 1 : 0;
+            const double scale = 2.0 / (deg - 1);
+            auto tie = [&](int a, int b) {
+                double d = std::fabs(coord(pins[a], axis) - coord(pins[b], axis));
+                connect(pins[a], pins[b], scale / std::max(d, (double)min_dist), axis);
+            };
+            tie(lo, hi);
+            for (int k = 0; k < deg; ++k) {
+                if (k == lo || k == hi) continue;
+                tie(k, lo);
+                tie(k, hi);
+            }
+        }
+
+        // Anchors: a weak one to the current position keeps cells without
+        // nets determined; the spreading anchor grows with anchor_scale.
+        double mean_diag = 0.0;
+        for (int k = 0; k < n; ++k) mean_diag += diag[k];
+        mean_diag = n ? std::max(mean_diag / n, 1e-12) : 1.0;
+        for (int k = 0; k < n; ++k) {
+            double base = std::max(diag[k], mean_diag);
+            double w_keep = kRegularization * base;
+            double w_anchor = anchor_scale * base;
+            diag[k] += w_keep + w_anchor;
+            rhs[k] += w_keep * pos[axis][k] + w_anchor * anchor[axis][k];
+        }
+
+        row_start.assign(n + 1, 0);
+        for (const Edge& e : edges) { row_start[e.a + 1]++; row_start[e.b + 1]++; }
+        for (int k = 0; k < n; ++k) row_start[k + 1] += row_start[k];
+        col.resize(row_start[n]);
+        val.resize(row_start[n]);
+        std::vector<uint32_t> fill(row_start.begin(), row_start.end() - 1);
+        for (const Edge& e : edges) {
+            col[fill[e.a]] = e.b; val[fill[e.a]++] = -e.w;
+            col[fill[e.b]] = e.a; val[fill[e.b]++] = -e.w;
+        }
+    }
+
+    // Runs fn(begin, end) over fixed chunks of [0, n) on the pool.
+    template <typename F>
+    void forChunks(int n, F fn) {
+        int chunks = (n + kChunk - 1) / kChunk;
+        pool.parallelFor(chunks, [&](int c, int) { fn(c * kChunk, std::min(n, (c + 1) * kChunk)); });
+    }
+
+    // Sum of f(k) over [0, n), added per chunk and then in chunk order.
+    template <typename F>
+    double sumChunks(int n, F f) {
+        int chunks = (n + kChunk - 1) / kChunk;
+        partial.assign(chunks, 0.0);
+        pool.parallelFor(chunks, [&](int c, int) {
+            double s = 0.0;
+            for (int k = c * kChunk; k < std::min(n, (c + 1) * kChunk); ++k) s += f(k);
+            partial[c] = s;
+        });
+        double total = 0.0;
+        for (double s : partial) total += s;
+        return total;
+    }
+
+    void multiply(const std::vector<double>& v, std::vector<double>& out) {
+        forChunks((int)v.size(), [&](int b, int e) {
+            for (int k = b; k < e; ++k) {
+                double s = diag[k] * v[k];
+                for (uint32_t j = row_start[k]; j < row_start[k + 1]; ++j) s += val[j] * v[col[j]];
+                out[k] = s;
+            }
+        });
+    }
+
+    // Jacobi-preconditioned CG on the current system, starting from x.
+    // Returns the iterations used.
+    int solve(std::vector<double>& x, int max_iters, double tol) {
+        const int n = (int)x.size();
+        r.resize(n); z.resize(n); p.resize(n); ap.resize(n);
+        multiply(x, ap);
+        forChunks(n, [&](int b, int e) {
+            for (int k = b; k < e; ++k) {
+                r[k] = rhs[k] - ap[k];
+                z[k] = r[k] / diag[k];
+                p[k] = z[k];
+            }
+        });
+        double rz = sumChunks(n, [&](int k) { return r[k] * z[k]; });
+        const double stop = tol * tol * sumChunks(n, [&](int k) { return rhs[k] * rhs[k]; });
+        int it = 0;
+        for (; it < max_iters; ++it) {
+            if (sumChunks(n, [&](int k) { return r[k] * r[k]; }) <= stop) break;
+            multiply(p, ap);
+            double pap = sumChunks(n, [&](int k) { return p[k] * ap[k]; });
+            if (pap <= 0.0) break;
+            const double alpha = rz / pap;
+            forChunks(n, [&](int b, int e) {
+                for (int k = b; k < e; ++k) {
+                    x[k] += alpha * p[k];
+                    r[k] -= alpha * ap[k];
+                    z[k] = r[k] / diag[k];
+                }
+            });
+            double rz_next = sumChunks(n, [&](int k) { return r[k] * z[k]; });
+            const double beta = rz_next / rz;
+            rz = rz_next;
+            forChunks(n, [&](int b, int e) {
+                for (int k = b; k < e; ++k) p[k] = z[k] + beta * p[k];
+            });
+        }
+        return it;
+    }
+
+    // About 16 cells per bin, bins roughly square in dbu.
+    void buildBins() {
+        const double die_w = std::max(1, db.die_x_max - db.die_x_min);
+        const double die_h = std::max(1, db.die_y_max - db.die_y_min);
+        const double bins = std::max(1.0, cells.size() / 16.0);
+        nbx = std::max(1, (int)std::lround(std::sqrt(bins * die_w / die_h)));
+        nby = std::max(1, (int)std::lround(bins / nbx));
+        bin_w = die_w / nbx;
+        bin_h = die_h / nby;
+
+        cap.assign((size_t)nbx * nby, 0.0);
+        for (const Row& row : db.rows) {
+            auto site = db.sites.find(row.site_name);
+            int height = site != db.sites.end() ? site->second.height_dbu : 0;
+            int width = site != db.sites.end() ? site->second.width_dbu : min_dist;
+            double row_end = row.x + (double)row.site_count * width;
+            double y0 = row.y, y1 = (double)row.y + height;
+            double from = row.x;
+            auto addFree = [&](double x0, double x1) {
+                if (x1 <= x0) return;
+                for (int by = binY(y0); by <= binY(y1 - 1e-9); ++by) {
+                    double oy = std::min(y1, db.die_y_min + (by + 1) * bin_h) - std::max(y0, db.die_y_min + by * bin_h);
+                    if (oy <= 0) continue;
+                    for (int bx = binX(x0); bx <= binX(x1 - 1e-9); ++bx) {
+                        double ox = std::min(x1, db.die_x_min + (bx + 1) * bin_w) - std::max(x0, db.die_x_min + bx * bin_w);
+                        if (ox > 0) cap[(size_t)by * nbx + bx] += ox * oy;
+                    }
+                }
+            };
+            for (const auto& b : row.blockages) {
+                addFree(from, std::min<double>(b.first, row_end));
+                from = std::max<double>(from, b.second);
+            }
+            addFree(from, row_end);
+        }
+
+        const int w = nbx + 1;
+        cap_sum.assign((size_t)w * (nby + 1), 0.0);
+        for (int by = 0; by < nby; ++by) {
+            for (int bx = 0; bx < nbx; ++bx) {
+                cap_sum[(size_t)(by + 1) * w + bx + 1] = cap[(size_t)by * nbx + bx] + cap_sum[(size_t)by * w + bx + 1]
+                                                       + cap_sum[(size_t)(by + 1) * w + bx] - cap_sum[(size_t)by * w + bx];
+            }
+        }
+    }
+
+    int binX(double x) const { return std::min(nbx - 1, std::max(0, (int)((x - db.die_x_min) / bin_w))); }
+    int binY(double y) const { return std::min(nby - 1, std::max(0, (int)((y - db.die_y_min) / bin_h))); }
+
+    double cellArea(int k) const {
+        const Inst& inst = db.instances[cells[k]];
+        return (double)inst.macro_width * inst.macro_height;
+    }
+
+    // Free area of bins [bx0, bx1) x [by0, by1).
+    double capacity(int bx0, int bx1, int by0, int by1) const {
+        const int w = nbx + 1;
+        return cap_sum[(size_t)by1 * w + bx1] - cap_sum[(size_t)by0 * w + bx1]
+             - cap_sum[(size_t)by1 * w + bx0] + cap_sum[(size_t)by0 * w + bx0];
+    }
+
+    // Recursive bisection of the bin region [bx0, bx1) x [by0, by1) holding
+    // cells [first, last) (movable indices into center[]). The region is cut
+    // in half across its longer side and the cells are split in coordinate
+    // order. Each cell stays on its side of the cut unless that side would
+    // exceed `density` times its capacity; then the cells nearest the cut
+    // move across it. A side that is already full shares the area in
+    // proportion to capacity. A cell moved across a cut is placed on the cut
+    // line. Inside a single bin the cells are translated, or scaled if they
+    // are wider than the bin, to fit it.
+    void bisect(int* first, int* last, int bx0, int bx1, int by0, int by1, double density) {
+        const int n = (int)(last - first);
+        if (n == 0) return;
+        if (bx1 - bx0 == 1 && by1 - by0 == 1) {
+            fitBin(first, last, bx0, by0);
+            return;
+        }
+        const bool cut_x = by1 - by0 == 1 || (bx1 - bx0 > 1 && (bx1 - bx0) * bin_w >= (by1 - by0) * bin_h);
+        std::vector<double>& c = center[cut_x ? 0 : 1];
+        std::sort(first, last, [&](int a, int b) { return c[a] != c[b] ? c[a] < c[b] : a < b; });
+
+        int mid;
+        double cut, cap_lo, cap_hi;
+        if (cut_x) {
+            mid = (bx0 + bx1) / 2;
+            cut = db.die_x_min + mid * bin_w;
+            cap_lo = capacity(bx0, mid, by0, by1);
+            cap_hi = capacity(mid, bx1, by0, by1);
+        } else {
+            mid = (by0 + by1) / 2;
+            cut = db.die_y_min + mid * bin_h;
+            cap_lo = capacity(bx0, bx1, by0, mid);
+            cap_hi = capacity(bx0, bx1, mid, by1);
+        }
+
+        // prefix[k]: area of the first k cells.
+        prefix.resize(n + 1);
+        prefix[0] = 0.0;
+        for (int k = 0; k < n; ++k) prefix[k + 1] = prefix[k] + cellArea(first[k]);
+        const double total = prefix[n];
+        auto firstAtLeast = [&](double a) {
+            return std::min(n, (int)(std::lower_bound(prefix.begin(), prefix.begin() + n + 1, a) - prefix.begin()));
+        };
+        int k = (int)(std::partition_point(first, last, [&](int m) { return c[m] < cut; }) - first);
+        if (total > density * (cap_lo + cap_hi)) {
+            double share = cap_lo + cap_hi > 0 ? cap_lo / (cap_lo + cap_hi) : 0.5;
+            k = firstAtLeast(total * share);
+        } else if (prefix[k] > density * cap_lo) {
+            k = firstAtLeast(density * cap_lo);
+            if (k > 0 && prefix[k] > density * cap_lo) --k;
+        } else if (total - prefix[k] > density * cap_hi) {
+            k = firstAtLeast(total - density * cap_hi);
+        }
+        for (int j = 0; j < k; ++j) c[first[j]] = std::min(c[first[j]], cut);
+        for (int j = k; j < n; ++j) c[first[j]] = std::max(c[first[j]], cut);
+
+        if (cut_x) {
+            bisect(first, first + k, bx0, mid, by0, by1, density);
+            bisect(first + k, last, mid, bx1, by0, by1, density);
+        } else {
+            bisect(first, first + k, bx0, bx1, by0, mid, density);
+            bisect(first + k, last, bx0, bx1, mid, by1, density);
+        }
+    }
+
+    void fitBin(const int* first, const int* last, int bx, int by) {
+        for (int axis = 0; axis < 2; ++axis) {
+            std::vector<double>& c = center[axis];
+            const double size = axis == 0 ? bin_w : bin_h;
+            const double r0 = (axis == 0 ? db.die_x_min + bx * bin_w : db.die_y_min + by * bin_h) + 0.01 * size;
+            const double r1 = r0 + 0.98 * size;
+            double lo = c[*first], hi = c[*first];
+            for (const int* m = first; m != last; ++m) { lo = std::min(lo, c[*m]); hi = std::max(hi, c[*m]); }
+            if (hi - lo > r1 - r0) {
+                for (const int* m = first; m != last; ++m) c[*m] = r0 + (c[*m] - lo) * (r1 - r0) / (hi - lo);
+            } else {
+                double move = lo < r0 ? r0 - lo : (hi > r1 ? r1 - hi : 0.0);
+                for (const int* m = first; m != last; ++m) c[*m] += move;
+            }
+        }
+    }
+
+    // Spreads the solved positions into anchor and returns the overflow of
+    // the solved placement: area above bin capacity over total cell area.
+    double spread() {
+        const int n = (int)cells.size();
+        area.assign(cap.size(), 0.0);
+        double total = 0.0;
+        for (int k = 0; k < n; ++k) {
+            const Inst& inst = db.instances[cells[k]];
+            center[0][k] = pos[0][k] + inst.macro_width * 0.5;
+            center[1][k] = pos[1][k] + inst.macro_height * 0.5;
+            area[(size_t)binY(center[1][k]) * nbx + binX(center[0][k])] += cellArea(k);
+            total += cellArea(k);
+        }
+        double over = 0.0;
+        for (size_t b = 0; b < cap.size(); ++b) over += std::max(0.0, area[b] - cap[b]);
+
+        const double free_area = cap_sum.back();
+        const double density = free_area > 0 ? std::max(kTargetDensity, total / free_area) : 1.0;
+        order.resize(n);
+        for (int k = 0; k < n; ++k) order[k] = k;
+        bisect(order.data(), order.data() + n, 0, nbx, 0, nby, density);
+
+        const double x_hi = db.die_x_max, y_hi = db.die_y_max;
+        for (int k = 0; k < n; ++k) {
+            const Inst& inst = db.instances[cells[k]];
+            anchor[0][k] = std::min(std::max(center[0][k] - inst.macro_width * 0.5, (double)db.die_x_min), x_hi - inst.macro_width);
+            anchor[1][k] = std::min(std::max(center[1][k] - inst.macro_height * 0.5, (double)db.die_y_min), y_hi - inst.macro_height);
+        }
+        return total > 0 ? over / total : 0.0;
+    }
+};
@@ -0,0 +1,461 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "db.h"
+#include "thread_pool.h"
+
+// Half-perimeter of n >= 1 points. x and y must stay readable up to the
+// next multiple of 8 past n (the AVX2 kernel loads whole vectors).
+static inline long long boxSpanScalar(const int32_t* x, const int32_t* y, int n) {
+    int32_t lo_x = x[0], hi_x = x[0], lo_y = y[0], hi_y = y[0];
+    for (int k = 1; k < n; ++k) {
+        lo_x = std::min(lo_x, x[k]); hi_x = std::max(hi_x, x[k]);
+        lo_y = std::min(lo_y, y[k]); hi_y = std::max(hi_y, y[k]);
+    }
+    return ((long long)hi_x - lo_x) + ((long long)hi_y - lo_y);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static inline int32_t hmin8(__m256i v) {
+    __m128i m = _mm_min_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+__attribute__((target("avx2"))) static inline int32_t hmax8(__m256i v) {
+    __m128i m = _mm_max_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(m);
+}
+
+// Eight pins per step; lanes past n are filled with the first pin, which
+// leaves the min and max unchanged.
+__attribute__((target("avx2"))) static long long boxSpanAvx2(const int32_t* x, const int32_t* y, int n) {
+    const __m256i first_x = _mm256_set1_epi32(x[0]), first_y = _mm256_set1_epi32(y[0]);
+    __m256i lo_x = first_x, hi_x = first_x, lo_y = first_y, hi_y = first_y;
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256i vx = _mm256_loadu_si256((const __m256i*)(x + k));
+        __m256i vy = _mm256_loadu_si256((const __m256i*)(y + k));
+        lo_x = _mm256_min_epi32(lo_x, vx); hi_x = _mm256_max_epi32(hi_x, vx);
+        lo_y = _mm256_min_epi32(lo_y, vy); hi_y = _mm256_max_epi32(hi_y, vy);
+    }
+    if (k < n) {
+        const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i live = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - k), lane);
+        __m256i vx = _mm256_blendv_epi8(first_x, _mm256_loadu_si256((const __m256i*)(x + k)), live);
+        __m256i vy = _mm256_blendv_epi8(first_y, _mm256_loadu_si256((const __m256i*)(y + k)), live);
+        lo_x = _mm256_min_epi32(lo_x, vx); hi_x = _mm256_max_epi32(hi_x, vx);
+        lo_y = _mm256_min_epi32(lo_y, vy); hi_y = _mm256_max_epi32(hi_y, vy);
+    }
+    return ((long long)hmax8(hi_x) - hmin8(lo_x)) + ((long long)hmax8(hi_y) - hmin8(lo_y));
+}
+#endif
+
+static inline void pinXY(const NetlistView &nl, const int64_t* cell_xy, int32_t r, int32_t &x, int32_t &y) {
+    if (r >= 0) {
+        int64_t xy = cell_xy[r];
+        x = (int32_t)xy;
+        y = (int32_t)(xy >> 32);
+    } else {
+        x = nl.io_x[~r];
+        y = nl.io_y[~r];
+    }
+}
+
+// Sum of net HPWLs for nets [net_begin, net_end), reading positions from the
+// packed per-cell table; each read is prefetched kAhead pins earlier. Nets
+// of fewer than kGatherPins pins, the large majority, are reduced in
+// registers as they are read. Larger ones are gathered into the x/y buffers
+// (structure of arrays, padded by 8) and reduced there by BoxSpan.
+template <long long (*BoxSpan)(const int32_t*, const int32_t*, int)>
+static long long sumNetHPWL(const NetlistView &nl, const int64_t* cell_xy, int net_begin, int net_end,
+                            std::vector<int32_t> &xs, std::vector<int32_t> &ys) {
+    const int32_t* ref = nl.pin_ref.data();
+    const uint32_t* start = nl.net_pin_start.data();
+    const uint32_t pin_end = start[net_end];
+    const uint32_t kAhead = 32;
+    const int kGatherPins = 16;
+    auto prefetch = [&](uint32_t k) {
+        uint32_t a = k + kAhead;
+        if (a < pin_end && ref[a] >= 0) __builtin_prefetch(cell_xy + ref[a]);
+    };
+
+    long long total = 0;
+    for (int net = net_begin; net < net_end; ++net) {
+        uint32_t b = start[net], e = start[net + 1];
+        int n = (int)(e - b);
+        if (n == 0) continue;
+        if (n < kGatherPins) {
+            int32_t lo_x, lo_y;
+            prefetch(b);
+            pinXY(nl, cell_xy, ref[b], lo_x, lo_y);
+            int32_t hi_x = lo_x, hi_y = lo_y;
+            for (uint32_t k = b + 1; k < e; ++k) {
+                int32_t x, y;
+                prefetch(k);
+                pinXY(nl, cell_xy, ref[k], x, y);
+                lo_x = std::min(lo_x, x); hi_x = std::max(hi_x, x);
+                lo_y = std::min(lo_y, y); hi_y = std::max(hi_y, y);
+            }
+            total += ((long long)hi_x - lo_x) + ((long long)hi_y - lo_y);
+            continue;
+        }
+        if ((size_t)n + 8 > xs.size()) { xs.resize(n + 8); ys.resize(n + 8); }
+        for (int k = 0; k < n; ++k) {
+            prefetch(b + k);
+            pinXY(nl, cell_xy, ref[b + k], xs[k], ys[k]);
+        }
+        total += BoxSpan(xs.data(), ys.data(), n);
+    }
+    return total;
+}
+
+// Nets by degree class for the placer's move evaluators. Most nets have 2
+// or 3 pins; their pin refs are copied into fixed-size records, so costing
+// one reads a single record instead of the CSR offsets and then the pin
+// list, and the kernel for it is unrolled with no loop or found flag.
+// Larger nets go through the CSR with the same kernel at a runtime count.
+// Positions come from pos(ref, x, y), which lets a caller substitute moved
+// or snapshot positions without copying anything.
+class NetDegreeTable {
+public:
+    void build(const NetlistView& netlist) {
+        nl = &netlist;
+        int num_nets = nl->numNets();
+        entry.assign(num_nets, 0);
+        pins2.clear();
+        pins3.clear();
+        for (int net = 0; net < num_nets; ++net) {
+            Span<int32_t> pins = nl->netPins(net);
+            if (pins.size() == 2) {
+                entry[net] = (kPair << kClassShift) | (uint32_t)(pins2.size() / 2);
+                pins2.insert(pins2.end(), pins.begin(), pins.end());
+            } else if (pins.size() == 3) {
+                entry[net] = (kTriple << kClassShift) | (uint32_t)(pins3.size() / 3);
+                pins3.insert(pins3.end(), pins.begin(), pins.end());
+            }
+        }
+    }
+
+    // HPWL change of net when moved(ref, x, y) overwrites the position of
+    // every pin that moves; each pin's current position is read once.
+    template <typename Pos, typename Moved>
+    long long spanDelta(uint32_t net, const Pos& pos, const Moved& moved, long long& pins_scanned) const {
+        uint32_t e = entry[net];
+        switch (e >> kClassShift) {
+        case kPair:
+            pins_scanned += 2;
+            return deltaOf<2>(&pins2[2 * (size_t)(e & kIndexMask)], 2, pos, moved);
+        case kTriple:
+            pins_scanned += 3;
+            return deltaOf<3>(&pins3[3 * (size_t)(e & kIndexMask)], 3, pos, moved);
+        default: {
+            Span<int32_t> pins = nl->netPins(net);
+            pins_scanned += pins.size();
+            return pins.empty() ? 0 : deltaOf<0>(pins.begin(), (int)pins.size(), pos, moved);
+        }
+        }
+    }
+
+    // Bounding box of the pins of net other than skip. Returns false if
+    // every pin is skip.
+    template <typename Pos>
+    bool boxWithout(uint32_t net, int32_t skip, const Pos& pos, int& lo_x, int& hi_x, int& lo_y, int& hi_y,
+                    long long& pins_scanned) const {
+        uint32_t e = entry[net];
+        switch (e >> kClassShift) {
+        case kPair:
+            pins_scanned += 2;
+            return boxOf<2>(&pins2[2 * (size_t)(e & kIndexMask)], 2, skip, pos, lo_x, hi_x, lo_y, hi_y);
+        case kTriple:
+            pins_scanned += 3;
+            return boxOf<3>(&pins3[3 * (size_t)(e & kIndexMask)], 3, skip, pos, lo_x, hi_x, lo_y, hi_y);
+        default: {
+            Span<int32_t> pins = nl->netPins(net);
+            pins_scanned += pins.size();
+            return boxOf<0>(pins.begin(), (int)pins.size(), skip, pos, lo_x, hi_x, lo_y, hi_y);
+        }
+        }
+    }
+
+private:
+    enum : uint32_t { kGeneral = 0, kPair = 1, kTriple = 2 };
+    enum : uint32_t { kClassShift = 30, kIndexMask = (1u << 30) - 1 };
+
+    const NetlistView* nl = nullptr;
+    std::vector<uint32_t> entry;        // net -> class << kClassShift | record index
+    std::vector<int32_t> pins2, pins3;  // records of 2- and 3-pin nets
+
+    // N > 0 fixes the pin count at compile time; N == 0 uses n (>= 1).
+    template <int N, typename Pos, typename Moved>
+    static long long deltaOf(const int32_t* pins, int n, const Pos& pos, const Moved& moved) {
+        const int count = N > 0 ? N : n;
+        int x, y;
+        pos(pins[0], x, y);
+        int lo_x = x, hi_x = x, lo_y = y, hi_y = y;
+        moved(pins[0], x, y);
+        int nlo_x = x, nhi_x = x, nlo_y = y, nhi_y = y;
+        for (int k = 1; k < count; ++k) {
+            pos(pins[k], x, y);
+            lo_x = std::min(lo_x, x); hi_x = std::max(hi_x, x);
+            lo_y = std::min(lo_y, y); hi_y = std::max(hi_y, y);
+            moved(pins[k], x, y);
+            nlo_x = std::min(nlo_x, x); nhi_x = std::max(nhi_x, x);
+            nlo_y = std::min(nlo_y, y); nhi_y = std::max(nhi_y, y);
+        }
+        return (((long long)nhi_x - nlo_x) + ((long long)nhi_y - nlo_y))
+             - (((long long)hi_x - lo_x) + ((long long)hi_y - lo_y));
+    }
+
+    template <int N, typename Pos>
+    static bool boxOf(const int32_t* pins, int n, int32_t skip, const Pos& pos,
+                      int& lo_x, int& hi_x, int& lo_y, int& hi_y) {
+        const int count = N > 0 ? N : n;
+        lo_x = lo_y = std::numeric_limits<int>::max();
+        hi_x = hi_y = std::numeric_limits<int>::min();
+        for (int k = 0; k < count; ++k) {
+            if (pins[k] == skip) continue;
+            int x, y;
+            pos(pins[k], x, y);
+            lo_x = std::min(lo_x, x); hi_x = std::max(hi_x, x);
+            lo_y = std::min(lo_y, y); hi_y = std::max(hi_y, y);
+        }
+        return lo_x <= hi_x;
+    }
+};
+
+// Extremes of the high-fanout nets, kept in step with the placement, so
+// that a move costs O(1) on such a net instead of a scan of its pins. Per
+// axis a net keeps its two smallest and two largest pin coordinates with
+// the number of pins at each; dropping a moving cell's pins from the box
+// then needs no scan unless it leaves both extremes of a side empty, in
+// which case the caller falls back to the pin list. A pin leaving the
+// second extreme rescans that axis of the net when the move is committed.
+// Each cell is counted once per net, since a repeated pin never changes
+// the box.
+class WideNetIndex {
+public:
+    // Indexes the nets of at least min_degree pins at the positions in
+    // instances.
+    void build(const NetlistView& netlist, const std::vector<Inst>& instances, int min_degree) {
+        nl = &netlist;
+        slot.assign(nl->numNets(), -1);
+        ref_start.assign(1, 0);
+        refs.clear();
+        ext.clear();
+        cell_x.resize(instances.size());
+        cell_y.resize(instances.size());
+        on_wide.assign(instances.size(), 0);
+        for (size_t i = 0; i < instances.size(); ++i) {
+            cell_x[i] = instances[i].x;
+            cell_y[i] = instances[i].y;
+        }
+        for (int net = 0; net < nl->numNets(); ++net) {
+            Span<int32_t> pins = nl->netPins(net);
+            if ((int)pins.size() < min_degree) continue;
+            size_t first = refs.size();
+            refs.insert(refs.end(), pins.begin(), pins.end());
+            std::sort(refs.begin() + first, refs.end());
+            refs.erase(std::unique(refs.begin() + first, refs.end()), refs.end());
+            for (size_t k = first; k < refs.size(); ++k)
+                if (refs[k] >= 0) on_wide[refs[k]] = 1;
+            slot[net] = (int)ext.size();
+            ref_start.push_back((uint32_t)refs.size());
+            ext.push_back(Extremes());
+            ext.push_back(Extremes());
+            rescan(slot[net], 0);
+            rescan(slot[net] + 1, 1);
+        }
+    }
+
+    bool wide(uint32_t net) const { return slot[net] >= 0; }
+
+    // Follows a cell to its current position.
+    void move(int cell, int x, int y) {
+        if (!on_wide[cell] || (cell_x[cell] == x && cell_y[cell] == y)) return;
+        int old_x = cell_x[cell], old_y = cell_y[cell];
+        cell_x[cell] = x;
+        cell_y[cell] = y;
+        for (uint32_t net : nl->cellNets(cell)) {
+            int s = slot[net];
+            if (s < 0) continue;
+            if (old_x != x) { if (ext[s].remove(old_x)) rescan(s, 0); else ext[s].add(x); }
+            if (old_y != y) { if (ext[s + 1].remove(old_y)) rescan(s + 1, 1); else ext[s + 1].add(y); }
+        }
+    }
+
+    // HPWL change of wide net when cell a moves to (ax, ay) and cell b to
+    // (bx, by); b may be -1 for none. Returns false if the extremes cannot
+    // tell.
+    bool delta(uint32_t net, int a, int ax, int ay, int b, int bx, int by, long long& d) const {
+        int s = slot[net];
+        bool has_a = contains(s, a), has_b = b >= 0 && contains(s, b);
+        const int kNone = std::numeric_limits<int>::min();
+        int lo_x, hi_x, lo_y, hi_y;
+        if (!ext[s].without(has_a ? cell_x[a] : kNone, has_b ? cell_x[b] : kNone, lo_x, hi_x)) return false;
+        if (!ext[s + 1].without(has_a ? cell_y[a] : kNone, has_b ? cell_y[b] : kNone, lo_y, hi_y)) return false;
+        if (has_a) { lo_x = std::min(lo_x, ax); hi_x = std::max(hi_x, ax); lo_y = std::min(lo_y, ay); hi_y = std::max(hi_y, ay); }
+        if (has_b) { lo_x = std::min(lo_x, bx); hi_x = std::max(hi_x, bx); lo_y = std::min(lo_y, by); hi_y = std::max(hi_y, by); }
+        d = (((long long)hi_x - lo_x) + ((long long)hi_y - lo_y)) - (ext[s].span() + ext[s + 1].span());
+        return true;
+    }
+
+    // Box of wide net over the pins of cells other than skip. Returns false
+    // if the extremes cannot tell.
+    bool boxWithout(uint32_t net, int skip, int& lo_x, int& hi_x, int& lo_y, int& hi_y) const {
+        int s = slot[net];
+        const int kNone = std::numeric_limits<int>::min();
+        bool has = contains(s, skip);
+        return ext[s].without(has ? cell_x[skip] : kNone, kNone, lo_x, hi_x)
+            && ext[s + 1].without(has ? cell_y[skip] : kNone, kNone, lo_y, hi_y);
+    }
+
+private:
+    // The two smallest and two largest distinct coordinates of one axis and
+    // how many pins sit at each; a count of 0 marks a value that is absent.
+    struct Extremes {
+        int lo1 = 0, lo2 = 0, hi1 = 0, hi2 = 0;
+        int n_lo1 = 0, n_lo2 = 0, n_hi1 = 0, n_hi2 = 0;
+
+        long long span() const { return (long long)hi1 - lo1; }
+
+        void add(int v) {
+            if (n_lo1 == 0 || v < lo1) { lo2 = lo1; n_lo2 = n_lo1; lo1 = v; n_lo1 = 1; }
+            else if (v == lo1) n_lo1++;
+            else if (n_lo2 == 0 || v < lo2) { lo2 = v; n_lo2 = 1; }
+            else if (v == lo2) n_lo2++;
+            if (n_hi1 == 0 || v > hi1) { hi2 = hi1; n_hi2 = n_hi1; hi1 = v; n_hi1 = 1; }
+            else if (v == hi1) n_hi1++;
+            else if (n_hi2 == 0 || v > hi2) { hi2 = v; n_hi2 = 1; }
+            else if (v == hi2) n_hi2++;
+        }
+
+        // Returns true if the second extreme of a side is no longer known.
+        bool remove(int v) {
+            bool lost = false;
+            if (v == lo1) {
+                if (--n_lo1 == 0) { lo1 = lo2; n_lo1 = n_lo2; lost = true; }
+            } else if (v == lo2) {
+                lost = --n_lo2 == 0;
+            }
+            if (v == hi1) {
+                if (--n_hi1 == 0) { hi1 = hi2; n_hi1 = n_hi2; lost = true; }
+            } else if (v == hi2) {
+                lost = --n_hi2 == 0 || lost;
+            }
+            return lost;
+        }
+
+        // Extent of the axis with one pin at each of r1 and r2 dropped
+        // (kNone for none).
+        bool without(int r1, int r2, int& lo, int& hi) const {
+            int k = (r1 == lo1) + (r2 == lo1);
+            if (n_lo1 > k) lo = lo1;
+            else if (n_lo2 > (r1 == lo2) + (r2 == lo2)) lo = lo2;
+            else return false;
+            k = (r1 == hi1) + (r2 == hi1);
+            if (n_hi1 > k) hi = hi1;
+            else if (n_hi2 > (r1 == hi2) + (r2 == hi2)) hi = hi2;
+            else return false;
+            return true;
+        }
+    };
+
+    const NetlistView* nl = nullptr;
+    std::vector<int> slot;              // net -> its x extremes in ext (y follows), -1 if not wide
+    std::vector<uint32_t> ref_start;    // wide net (slot / 2) -> its refs, sorted and distinct
+    std::vector<int32_t> refs;
+    std::vector<Extremes> ext;
+    std::vector<int> cell_x, cell_y;    // positions the extremes reflect
+    std::vector<char> on_wide;          // cell has a pin on some wide net
+
+    bool contains(int s, int cell) const {
+        return std::binary_search(refs.begin() + ref_start[s / 2], refs.begin() + ref_start[s / 2 + 1], cell);
+    }
+
+    void rescan(int s, int axis) {
+        Extremes& e = ext[s];
+        e = Extremes();
+        for (uint32_t k = ref_start[s / 2]; k < ref_start[s / 2 + 1]; ++k) {
+            int32_t r = refs[k];
+            if (r >= 0) e.add(axis == 0 ? cell_x[r] : cell_y[r]);
+            else e.add(axis == 0 ? nl->io_x[~r] : nl->io_y[~r]);
+        }
+    }
+};
+
+// Full-design HPWL. The packed position table is kept between calls so
+// repeated evaluation (after every pass) does not reallocate it. With a
+// pool, nets are cut into ranges of about equal pin count that are summed
+// in parallel; the sum is exact, so the result does not depend on the
+// thread count.
+class HpwlEvaluator {
+public:
+    long long total(const DesignDB &db, ThreadPool* pool = nullptr) {
+        const NetlistView &nl = db.netlist;
+        int num_nets = nl.numNets();
+        if (num_nets == 0) return 0;
+
+        long long (*sum)(const NetlistView&, const int64_t*, int, int, std::vector<int32_t>&, std::vector<int32_t>&) =
+            sumNetHPWL<boxSpanScalar>;
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool has_avx2 = __builtin_cpu_supports("avx2");
+        if (has_avx2) sum = sumNetHPWL<boxSpanAvx2>;
+#endif
+
+        // Positions packed to 8 bytes per cell, so the random per-pin reads
+        // land in a table a fraction of the size of the instance array.
+        const int num_cells = db.instances.size();
+        cell_xy.resize(num_cells);
+        auto pack = [&](int c0, int c1) {
+            for (int c = c0; c < c1; ++c)
+                cell_xy[c] = (int64_t)(((uint64_t)(uint32_t)db.instances[c].y << 32) | (uint32_t)db.instances[c].x);
+        };
+
+        const long long kMinPinsPerRange = 1 << 16;
+        long long total_pins = nl.pin_ref.size();
+        int ranges = pool ? pool->size() * 4 : 1;
+        ranges = (int)std::max(1LL, std::min<long long>(ranges, total_pins / kMinPinsPerRange));
+        if (ranges == 1) {
+            pack(0, num_cells);
+            std::vector<int32_t> xs(64), ys(64);
+            return sum(nl, cell_xy.data(), 0, num_nets, xs, ys);
+        }
+        pool->parallelFor(ranges, [&](int r, int) {
+            pack((int)((long long)num_cells * r / ranges), (int)((long long)num_cells * (r + 1) / ranges));
+        });
+
+        std::vector<int> cut(ranges + 1, num_nets);
+        cut[0] = 0;
+        for (int r = 1; r < ranges; ++r) {
+            uint32_t target = (uint32_t)(total_pins * r / ranges);
+            cut[r] = (int)(std::upper_bound(nl.net_pin_start.begin(), nl.net_pin_start.begin() + num_nets, target)
+                           - nl.net_pin_start.begin()) - 1;
+            cut[r] = std::max(cut[r], cut[r - 1]);
+        }
+        std::vector<long long> partial(ranges, 0);
+        pool->parallelFor(ranges, [&](int r, int) {
+            std::vector<int32_t> xs(64), ys(64);
+            partial[r] = sum(nl, cell_xy.data(), cut[r], cut[r + 1], xs, ys);
+        });
+        long long total = 0;
+        for (long long p : partial) total += p;
+        return total;
+    }
+
+private:
+    std::vector<int64_t> cell_xy;
+};
+
+long long calculateTotalHPWL(const DesignDB &db, ThreadPool* pool = nullptr) {
+    HpwlEvaluator eval;
+    return eval.total(db, pool);
+}
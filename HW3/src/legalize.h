@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "db.h"
+#include "thread_pool.h"
+
+struct LegalizeStats {
+    int cells = 0;                      // movable cells considered
+    int unplaced = 0;                   // cells no segment had room for; left where they were
+    int moved = 0;                      // cells whose position changed
+    long long total_displacement = 0;   // sum of |dx| + |dy| in dbu
+    long long max_displacement = 0;
+};
+
+// Abacus-style row legalization (Spindler, Schlichtmann and Johannes, ISPD
+// 2008). Every row is cut into segments of free sites between its
+// blockages. Cells are taken in x order and each is assigned to the segment
+// with the lowest estimated displacement among the nearest rows that still
+// have room for it; a segment never takes more cell width than it has
+// sites, so every assigned cell ends up legal. Segments are then placed
+// independently, one row per task: cells are appended left to right, and a
+// cell that overlaps its left neighbour merges into its cluster, which moves
+// to the position minimizing the summed squared displacement of its cells,
+// clamped to the segment. Positions are solved in sites and rounded per
+// cluster, which keeps neighbouring clusters apart.
+//
+// Sorting the cells dominates: row selection stops at the first row farther
+// away than the best candidate, and each cell merges into a cluster at most
+// once per placement.
+class AbacusLegalizer {
+public:
+    // Moves every movable cell of db onto a row segment, setting x, y,
+    // row_id and orient, and refills Row::cells to match.
+    LegalizeStats run(DesignDB& db, const RowIndex& row_index, int site_width, ThreadPool& pool) {
+        LegalizeStats stats;
+        buildSegments(db, site_width);
+
+        order.clear();
+        for (int i = 0; i < (int)db.instances.size(); ++i) {
+            if (!db.instances[i].is_fixed) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            const Inst& ia = db.instances[a];
+            const Inst& ib = db.instances[b];
+            return ia.x != ib.x ? ia.x < ib.x : a < b;
+        });
+        stats.cells = (int)order.size();
+
+        seg_of.assign(db.instances.size(), -1);
+        target.assign(db.instances.size(), 0.0);
+        for (int id : order) {
+            if (!assign(db, row_index, site_width, id)) stats.unplaced++;
+        }
+
+        // Cells per segment, kept in x order.
+        seg_cell_start.assign(segs.size() + 1, 0);
+        for (int id : order) {
+            if (seg_of[id] >= 0) seg_cell_start[seg_of[id] + 1]++;
+        }
+        for (size_t s = 0; s < segs.size(); ++s) seg_cell_start[s + 1] += seg_cell_start[s];
+        seg_cells.resize(seg_cell_start.back());
+        std::vector<int> fill(seg_cell_start.begin(), seg_cell_start.end() - 1);
+        for (int id : order) {
+            if (seg_of[id] >= 0) seg_cells[fill[seg_of[id]]++] = id;
+        }
+
+        const int num_rows = (int)db.rows.size();
+        if ((int)clusters.size() < pool.size()) clusters.resize(pool.size());
+        std::vector<LegalizeStats> row_stats(num_rows);
+        pool.parallelFor(num_rows, [&](int r, int worker) {
+            Row& row = db.rows[r];
+            row.cells.clear();
+            for (int s = row_seg_start[r]; s < row_seg_start[r + 1]; ++s) {
+                placeSegment(db, s, site_width, clusters[worker], row_stats[r]);
+            }
+            if (!row.cells.isSorted()) row.cells.sort();
+        });
+        for (const auto& rs : row_stats) {
+            stats.moved += rs.moved;
+            stats.total_displacement += rs.total_displacement;
+            stats.max_displacement = std::max(stats.max_displacement, rs.max_displacement);
+        }
+        return stats;
+    }
+
+private:
+    struct Segment {
+        int row;
+        int s0, s1;          // free sites [s0, s1)
+        int used;            // sites taken by assigned cells
+        double tail;         // right end of the assigned cells packed from their targets
+    };
+
+    struct Cluster {
+        double e, q;         // weight and weighted target of the cluster's left edge
+        int w;               // width in sites
+        int first;           // index of its first cell in the segment's list
+        double x;
+    };
+
+    std::vector<Segment> segs;
+    std::vector<int> row_seg_start;     // row -> segs (CSR), segments in x order
+    std::vector<int> order;
+    std::vector<int> seg_of;            // cell -> segment, -1 if unassigned
+    std::vector<double> target;         // cell -> desired left site in its segment's row
+    std::vector<int> seg_cell_start, seg_cells;
+    std::vector<std::vector<Cluster>> clusters;  // per worker
+
+    static int sitesOf(int width, int site_width) { return (width + site_width - 1) / site_width; }
+
+    static long long floorDiv(long long a, long long b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+    void buildSegments(const DesignDB& db, int site_width) {
+        segs.clear();
+        row_seg_start.assign(db.rows.size() + 1, 0);
+        for (int r = 0; r < (int)db.rows.size(); ++r) {
+            const Row& row = db.rows[r];
+            int cursor = 0;
+            for (const auto& b : row.blockages) {
+                long long b0 = floorDiv((long long)b.first - row.x, site_width);
+                long long b1 = -floorDiv((long long)row.x - b.second, site_width);
+                b0 = std::max(0LL, std::min<long long>(b0, row.site_count));
+                b1 = std::max(0LL, std::min<long long>(b1, row.site_count));
+                if (b0 > cursor) segs.push_back(Segment{r, cursor, (int)b0, 0, (double)cursor});
+                cursor = std::max(cursor, (int)b1);
+            }
+            if (row.site_count > cursor) segs.push_back(Segment{r, cursor, row.site_count, 0, (double)cursor});
+            row_seg_start[r + 1] = (int)segs.size();
+        }
+    }
+
+    // Estimated cost, in dbu, of adding a cell of w sites targeted at site t
+    // to seg: its own move to where left-to-right packing would put it, plus
+    // how far that packing overflows the segment (the cells Abacus will have
+    // to push left). Infinite if the segment is full.
+    static double segmentCost(const Segment& seg, double t, int w, int site_width) {
+        if (seg.used + w > seg.s1 - seg.s0) return std::numeric_limits<double>::infinity();
+        double p = std::max(t, seg.tail);
+        double over = std::max(0.0, p - (seg.s1 - w));
+        p = std::min(std::max(p, (double)seg.s0), (double)(seg.s1 - w));
+        return (std::fabs(p - t) + over) * site_width;
+    }
+
+    bool assign(const DesignDB& db, const RowIndex& row_index, int site_width, int id) {
+        const Inst& inst = db.instances[id];
+        const int w = sitesOf(inst.macro_width, site_width);
+        double best = std::numeric_limits<double>::infinity();
+        int best_seg = -1;
+        double best_t = 0.0;
+        row_index.forEachRowByDistance(inst.y, inst.macro_height, [&](int r, long long dy) {
+            if ((double)dy >= best) return false;
+            const Row& row = db.rows[r];
+            double t = (double)(inst.x - row.x) / site_width;
+            auto offer = [&](int s) {
+                double cost = dy + segmentCost(segs[s], t, w, site_width);
+                if (cost < best) { best = cost; best_seg = s; best_t = t; }
+            };
+            const int s_begin = row_seg_start[r], s_end = row_seg_start[r + 1];
+            // First segment ending right of t; the ones before it lie left of t.
+            int k = (int)(std::partition_point(segs.begin() + s_begin, segs.begin() + s_end,
+                                               [&](const Segment& sg) { return sg.s1 <= t; }) - segs.begin());
+            for (int s = k; s < s_end; ++s) {
+                if (dy + std::max(0.0, segs[s].s0 - t) * site_width >= best) break;
+                offer(s);
+            }
+            for (int s = k - 1; s >= s_begin; --s) {
+                if (dy + std::max(0.0, t - (segs[s].s1 - w)) * site_width >= best) break;
+                offer(s);
+            }
+            return true;
+        });
+        if (best_seg < 0) return false;
+        Segment& seg = segs[best_seg];
+        seg.used += w;
+        seg.tail = std::max(best_t, seg.tail) + w;
+        seg_of[id] = best_seg;
+        target[id] = best_t;
+        return true;
+    }
+
+    void placeSegment(DesignDB& db, int s, int site_width, std::vector<Cluster>& cl, LegalizeStats& stats) {
+        const Segment& seg = segs[s];
+        const int* cells = seg_cells.data() + seg_cell_start[s];
+        const int m = seg_cell_start[s + 1] - seg_cell_start[s];
+        if (m == 0) return;
+
+        cl.clear();
+        for (int k = 0; k < m; ++k) {
+            int w = sitesOf(db.instances[cells[k]].macro_width, site_width);
+            cl.push_back(Cluster{1.0, target[cells[k]], w, k, 0.0});
+            for (;;) {
+                Cluster& c = cl.back();
+                c.x = std::min(std::max(c.q / c.e, (double)seg.s0), (double)(seg.s1 - c.w));
+                if (cl.size() < 2) break;
+                Cluster& prev = cl[cl.size() - 2];
+                if (prev.x + prev.w <= c.x) break;
+                prev.e += c.e;
+                prev.q += c.q - c.e * prev.w;
+                prev.w += c.w;
+                cl.pop_back();
+            }
+        }
+
+        Row& row = db.rows[seg.row];
+        for (size_t c = 0; c < cl.size(); ++c) {
+            long long pos = std::llround(cl[c].x);
+            pos = std::min<long long>(std::max<long long>(pos, seg.s0), seg.s1 - cl[c].w);
+            int end = c + 1 < cl.size() ? cl[c + 1].first : m;
+            for (int k = cl[c].first; k < end; ++k) {
+                Inst& inst = db.instances[cells[k]];
+                int x = (int)(row.x + pos * site_width);
+                long long d = std::llabs((long long)x - inst.x) + std::llabs((long long)row.y - inst.y);
+                if (d > 0) stats.moved++;
+                stats.total_displacement += d;
+                stats.max_displacement = std::max(stats.max_displacement, d);
+                inst.x = x;
+                inst.y = row.y;
+                inst.row_id = seg.row;
+                inst.orient = row.orient;
+                row.cells.push_back(x, cells[k]);
+                pos += sitesOf(inst.macro_width, site_width);
+            }
+        }
+    }
+};
@@ -6,23 +6,23 @@
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <thread>
 using namespace std;
 #include "db.h"
 #include "parse_lef.h"
 #include "parse_def.h"
+#include "preprocess.h"
 #include "placer.h"
+#include "write_def.h"
+#include "snapshot.h"
+#include "scheduler.h"
+#include "telemetry.h"
 
 using namespace std;
 
 using Clock = std::chrono::high_resolution_clock;
 
 
-long long calculateTotalHPWL(const DesignDB &db);
-void linkInstMacro(DesignDB &db);
-void assignInstToRows(DesignDB &db);
-void writeDEF(const DesignDB &db, const std::string &def_in_path, const std::string &def_out_path);
-void stampBlockages(DesignDB &db);
-
 /*
 ./../bin/hw3 ../testcase/public1.lef ../testcase/public1.def ../output/output.def
 */
@@ -33,117 +33,208 @@ int main(int argc, char** argv) {
     srand(time(NULL));
 
     if (argc < 4) {
-        std::cerr << "Usage: ./hw3 <input.lef> <input.def> <output.def>\n";
+        std::cerr << "Usage: ./hw3 <input.lef> <input.def> <output.def> [--budget <seconds>] [--snapshot <file>] [--trace <file.jsonl>] [--verbose <0-2>] [--global] [--wide-nets <degree>]\n";
         return 1;
     }
     std::string lef_path = argv[1];
     std::string def_in   = argv[2];
     std::string def_out  = argv[3];
+    std::string snapshot_path;
+    double budget_s = 260.0;
+    bool global_place = false;
+    int wide_net_degree = 32;
+    Telemetry telemetry;
+    for (int a = 4; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--snapshot" && a + 1 < argc) {
+            snapshot_path = argv[++a];
+        } else if (arg == "--budget" && a + 1 < argc) {
+            budget_s = std::atof(argv[++a]);
+            if (budget_s <= 0) {
+                std::cerr << "--budget must be a positive number of seconds\n";
+                return 1;
+            }
+        } else if (arg == "--trace" && a + 1 < argc) {
+            if (!telemetry.openTrace(argv[++a])) return 1;
+        } else if (arg == "--verbose" && a + 1 < argc) {
+            telemetry.verbosity = std::atoi(argv[++a]);
+        } else if (arg == "--global") {
+            global_place = true;
+        } else if (arg == "--wide-nets" && a + 1 < argc) {
+            wide_net_degree = std::atoi(argv[++a]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
 
 
     DesignDB db;
+    const int num_threads = (int)std::max(1u, std::thread::hardware_concurrency());
 
     auto t_parse_start = Clock::now();
 
-    parseLEF(lef_path, db);
-    parseDEF(def_in, db);
-    linkInstMacro(db);
-    stampBlockages(db);
-    assignInstToRows(db);
+    // A snapshot built from the same LEF/DEF replaces all of the steps below.
+    bool from_snapshot = !snapshot_path.empty() && loadSnapshot(snapshot_path, lef_path, def_in, db);
+    if (from_snapshot && telemetry.verbosity >= 1) {
+        std::cout << "[Snapshot] Loaded " << snapshot_path << ": insts=" << db.instances.size()
+                  << " nets=" << db.nets.size() << " rows=" << db.rows.size() << std::endl;
+    }
+    if (!from_snapshot) {
+        parseLEF(lef_path, db);
+        if (telemetry.verbosity >= 1) {
+            std::cout << "[LEF] dbu_per_micron=" << db.lef_dbu_per_micron
+                      << " macros=" << db.macros.size()
+                      << " sites=" << db.sites.size()
+                      << " (core_site_width=" << db.core_site_width_dbu << " dbu)" << std::endl;
+        }
+        parseDEF(def_in, db, num_threads);
+        if (telemetry.verbosity >= 1) {
+            std::cout << "[DEF] Parsed DIEAREA: (0, 0) to ("
+                      << db.die_x_max << ", " << db.die_y_max << ")" << std::endl;
+            std::cout << "[DEF] dbu_per_micron=" << db.def_dbu_per_micron
+                      << " rows=" << db.rows.size()
+                      << " insts=" << db.instances.size()
+                      << " nets=" << db.nets.size()
+                      << " io_pins=" << db.io_pins.size() << std::endl;
+        }
+        linkInstMacro(db);
+        if (telemetry.verbosity >= 1) std::cout << "[Main] Stamping blockages..." << std::endl;
+        stampBlockages(db);
+        assignInstToRows(db);
+        renumberInstances(db);
+        buildNetlistView(db);
+        if (telemetry.verbosity >= 2) {
+            std::cout << "[Main] Netlist view: pins=" << db.netlist.pin_ref.size()
+                      << " io_pins=" << db.netlist.io_x.size()
+                      << " cell_net_refs=" << db.netlist.cell_nets.size() << std::endl;
+        }
+        if (!snapshot_path.empty() && saveSnapshot(db, lef_path, def_in, snapshot_path) && telemetry.verbosity >= 1) {
+            std::cout << "[Main] Saved snapshot to " << snapshot_path << std::endl;
+        }
+    }
 
     auto t_parse_end = Clock::now();
     auto parse_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_parse_end - t_parse_start);
+    telemetry.emit(JsonLine("parse")
+        .field("ms", std::chrono::duration<double, std::milli>(t_parse_end - t_parse_start).count())
+        .field("snapshot", from_snapshot)
+        .field("cells", (long long)db.instances.size())
+        .field("nets", (long long)db.nets.size())
+        .field("threads", num_threads)
+        .field("peak_rss_kb", peakRssKb()));
 
 
     long long initial_hpwl = calculateTotalHPWL(db);
     std::cout << "===== Initial HPWL Report =====" << std::endl;
     std::cout << "Calculated HPWL: " << initial_hpwl << std::endl;
-    std::cout << "Expected HPWL:   " << 41714599410 << " (for public4)" << std::endl;
     std::cout << "=============================" << std::endl;
 
 
-    auto t_algo_start = Clock::now();
-    std::cout << "\n=== DEBUG: DB Integrity Check ===" << std::endl;
-    std::cout << "DB Sites loaded: " << db.sites.size() << std::endl;
-    for(auto& kv : db.sites) {
-        std::cout << "  Key: '" << kv.first << "', W=" << kv.second.width_dbu << ", H=" << kv.second.height_dbu << std::endl;
-    }
-    if (!db.rows.empty()) {
-        std::cout << "First Row: Name='" << db.rows[0].name << "', SiteName='" << db.rows[0].site_name << "'" << std::endl;
-        if (db.sites.find(db.rows[0].site_name) == db.sites.end()) {
-            std::cout << "  [ERROR] Row SiteName NOT FOUND in DB Sites!" << std::endl;
+    if (telemetry.verbosity >= 2) {
+        std::cout << "\n=== DEBUG: DB Integrity Check ===" << std::endl;
+        std::cout << "DB Sites loaded: " << db.sites.size() << std::endl;
+        for(auto& kv : db.sites) {
+            std::cout << "  Key: '" << kv.first << "', W=" << kv.second.width_dbu << ", H=" << kv.second.height_dbu << std::endl;
+        }
+        if (!db.rows.empty()) {
+            std::cout << "First Row: Name='" << db.rows[0].name << "', SiteName='" << db.rows[0].site_name << "'" << std::endl;
+            if (db.sites.find(db.rows[0].site_name) == db.sites.end()) {
+                std::cout << "  [ERROR] Row SiteName NOT FOUND in DB Sites!" << std::endl;
+            } else {
+                std::cout << "  [OK] Row SiteName found in DB." << std::endl;
+            }
         } else {
-            std::cout << "  [OK] Row SiteName found in DB." << std::endl;
+            std::cout << "No Rows loaded!" << std::endl;
         }
-    } else {
-        std::cout << "No Rows loaded!" << std::endl;
+        std::cout << "CoreSite Width (DBU): " << db.core_site_width_dbu << std::endl;
+        std::cout << "=================================\n" << std::endl;
     }
-    std::cout << "CoreSite Width (DBU): " << db.core_site_width_dbu << std::endl;
-    std::cout << "=================================\n" << std::endl;
-
 
+    auto t_algo_start = Clock::now();
     Placer myPlacer(db);
     myPlacer.initializeBinGrid(100, 100);
-
-    const long long max_algo_ms_budget = 260000;
-    int target_outer_loops = 1;
-    auto time_used_ms = [&](){
-        auto now = Clock::now();
-        return std::chrono::duration_cast<std::chrono::milliseconds>(now - t_algo_start).count();
-    };
-
-
-    for (int iter = 0; iter < target_outer_loops && iter < 6; ++iter) {
-        auto iter_start = Clock::now();
-        std::cout << "--- Iteration " << iter << " ---" << std::endl;
-        if (time_used_ms() > max_algo_ms_budget) {
-            std::cout << "[Main] Time budget reached, stopping iterations.\n";
-            break;
-        }
-
-
-        myPlacer.runGlobalInsertOrSwap();
-        myPlacer.runSlidingWindow(2);
-        cout << db.instances.size() << "\n";
-        int rns_cells = std::min<int>(500000, db.instances.size());
-        myPlacer.runRowNeighborhoodSwap(rns_cells, 3);
-        myPlacer.runSlidingWindow(2);
-
-
-        auto iter_end = Clock::now();
-        if (iter == 0) {
-            auto iter_ms = std::chrono::duration_cast<std::chrono::milliseconds>(iter_end - iter_start).count();
-            if (iter_ms > 0) {
-                int extra = (int)(280000.0 / iter_ms) - 1;
-                if (extra < 0) extra = 0;
-                target_outer_loops = 1 + extra;
-            }
+    myPlacer.setNumThreads(num_threads);
+    myPlacer.setWideNetDegree(wide_net_degree);
+    if (telemetry.verbosity >= 1)
+        std::cout << "[Main] Placer: 100x100 bin grid, " << num_threads << " thread(s), budget " << budget_s << " s" << std::endl;
+
+    // The budget covers the placement passes and the final legalization; a
+    // slice of it is held back so legalization always gets to run.
+    auto budget = std::chrono::duration_cast<PassScheduler::Clock::duration>(
+        std::chrono::duration<double>(budget_s));
+    auto legalize_reserve = std::min<PassScheduler::Clock::duration>(
+        std::max<PassScheduler::Clock::duration>(budget / 50, std::chrono::milliseconds(20)),
+        std::chrono::seconds(5));
+    auto pass_deadline = PassScheduler::Clock::now() + budget - legalize_reserve;
+
+    // Global placement may use up to 40% of the budget; whatever it leaves
+    // goes to the detailed passes.
+    if (global_place) {
+        auto t_global_start = Clock::now();
+        myPlacer.setDeadline(PassScheduler::Clock::now() + budget * 2 / 5);
+        GlobalPlaceStats gp = myPlacer.runGlobalPlacement(40);
+        myPlacer.clearDeadline();
+        double global_ms = std::chrono::duration<double, std::milli>(Clock::now() - t_global_start).count();
+        if (telemetry.verbosity >= 1) {
+            std::cout << "[Main] Global placement: " << gp.iterations << " iterations, overflow " << gp.overflow
+                      << ", HPWL " << gp.hpwl_before << " -> " << gp.hpwl_after
+                      << (gp.kept ? "" : " (not kept)") << ", " << global_ms << " ms" << std::endl;
         }
+        telemetry.emit(JsonLine("global")
+            .field("ms", global_ms)
+            .field("iterations", gp.iterations)
+            .field("cg_iterations", gp.cg_iterations)
+            .field("overflow", gp.overflow)
+            .field("hpwl_before", gp.hpwl_before)
+            .field("hpwl_after", gp.hpwl_after)
+            .field("kept", gp.kept)
+            .field("peak_rss_kb", peakRssKb()));
     }
 
-
-
-    myPlacer.runRowLegalize();
-
-
+    int rns_cells = std::min<int>(500000, db.instances.size());
+    PassScheduler scheduler(myPlacer, db, telemetry);
+    scheduler.addPass("GlobalInsertOrSwap", [&]{ myPlacer.runGlobalInsertOrSwap(); });
+    scheduler.addPass("TiledInsertOrSwap", [&]{ myPlacer.runTiledInsertOrSwap(Placer::tilesPerSide(num_threads)); });
+    scheduler.addPass("IndependentSetMatching", [&]{ myPlacer.runIndependentSetMatching(25, 64); });
+    scheduler.addPass("SlidingWindow(4)", [&]{ myPlacer.runSlidingWindow(4); });
+    scheduler.addPass("RowNeighborhoodSwap", [&]{ myPlacer.runRowNeighborhoodSwap(rns_cells, 3); });
+    scheduler.run(pass_deadline);
+    if (telemetry.verbosity >= 1) scheduler.report(std::cout);
+
+    auto t_legalize_start = Clock::now();
+    LegalizeStats legal = myPlacer.runRowLegalize();
     auto t_algo_end = Clock::now();
+    if (legal.unplaced > 0) {
+        std::cerr << "[Main] Warning: " << legal.unplaced << " cell(s) did not fit on any row and were left in place" << std::endl;
+    }
+    if (telemetry.verbosity >= 1) {
+        std::cout << "[Main] Legalize: moved " << legal.moved << " of " << legal.cells
+                  << " cells, max displacement " << legal.max_displacement << std::endl;
+    }
+    telemetry.emit(JsonLine("legalize")
+        .field("ms", std::chrono::duration<double, std::milli>(t_algo_end - t_legalize_start).count())
+        .field("cells_moved", legal.moved)
+        .field("displacement", legal.total_displacement)
+        .field("max_displacement", legal.max_displacement)
+        .field("unplaced", legal.unplaced)
+        .field("peak_rss_kb", peakRssKb()));
 
     auto algo_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_algo_end - t_algo_start);
 
 
-    long long final_hpwl = calculateTotalHPWL(db);
+    long long final_hpwl = myPlacer.totalHPWL();
     std::cout << "===== Final HPWL Report =====" << std::endl;
     std::cout << "Initial HPWL: " << initial_hpwl << std::endl;
     std::cout << "Final HPWL:   " << final_hpwl << std::endl;
     std::cout << "Improvement:  " << (initial_hpwl - final_hpwl) << std::endl;
-    std::cout << "Baseline:     " << 41714599410 << " (for public4)" << std::endl;
     std::cout << "=============================" << std::endl;
 
 
 
-    std::cout << "[Main] Writing output DEF file to " << def_out << "..." << std::endl;
+    if (telemetry.verbosity >= 1) std::cout << "[Main] Writing output DEF file to " << def_out << "..." << std::endl;
     writeDEF(db, def_in, def_out);
-    std::cout << "[Main] ...Done." << std::endl;
+    if (telemetry.verbosity >= 1) std::cout << "[Main] ...Done." << std::endl;
 
     auto t_total_end = Clock::now();
     auto total_time_s = std::chrono::duration_cast<std::chrono::seconds>(t_total_end - t_total_start);
@@ -155,268 +246,13 @@ int main(int argc, char** argv) {
     std::cout << "Total Execution Time:    " << total_time_s.count() << " s" << std::endl;
     std::cout << "====================================" << std::endl;
 
-    return 0;
-}
-
-
-long long calculateTotalHPWL(const DesignDB &db) {
-    long long total_hpwl = 0;
-    for (const auto &net : db.nets) {
-        if (net.pins.empty()) continue;
-        long long min_x = std::numeric_limits<long long>::max();
-        long long max_x = std::numeric_limits<long long>::min();
-        long long min_y = std::numeric_limits<long long>::max();
-        long long max_y = std::numeric_limits<long long>::min();
-        bool at_least_one_pin_found = false;
-        for (const auto &pin : net.pins) {
-            long long pin_x = 0;
-            long long pin_y = 0;
-            bool pin_found = false;
-            if (pin.is_port) {
-                auto it = db.io_pins.find(pin.port_name);
-                if (it != db.io_pins.end()) {
-                    pin_x = it->second.x;
-                    pin_y = it->second.y;
-                    pin_found = true;
-                }
-            } else {
-                if (pin.inst_id >= 0 && pin.inst_id < (int)db.instances.size()) {
-                    const auto &inst = db.instances[pin.inst_id];
-                    pin_x = inst.x;
-                    pin_y = inst.y;
-                    pin_found = true;
-                }
-            }
-            if (pin_found) {
-                min_x = std::min(min_x, pin_x);
-                max_x = std::max(max_x, pin_x);
-                min_y = std::min(min_y, pin_y);
-                max_y = std::max(max_y, pin_y);
-                at_least_one_pin_found = true;
-            }
-        }
-        if (at_least_one_pin_found) {
-            long long net_hpwl = (max_x - min_x) + (max_y - min_y);
-            total_hpwl += net_hpwl;
-        }
-    }
-    return total_hpwl;
-}
-
-void stampBlockages(DesignDB &db) {
-    std::cout << "[Main] Stamping blockages..." << std::endl;
-
-    for (const auto& inst : db.instances) {
-
-        if (!inst.is_fixed) continue;
-
-
-        int block_x_start = inst.x;
-        int block_x_end = inst.x + inst.macro_width;
-        int block_y_start = inst.y;
-        int block_y_end = inst.y + inst.macro_height;
-
-
-        for (auto& row : db.rows) {
-
-            if (db.sites.find(row.site_name) == db.sites.end()) continue;
-            int row_height = db.sites.at(row.site_name).height_dbu;
-
-            int row_y_start = row.y;
-            int row_y_end = row.y + row_height;
-
-
-
-            bool y_overlaps = (block_y_start < row_y_end) && (block_y_end > row_y_start);
-
-            if (y_overlaps) {
-
-                row.blockages.push_back( {block_x_start, block_x_end} );
-            }
-        }
-    }
-
-
-    for (auto& row : db.rows) {
-        std::sort(row.blockages.begin(), row.blockages.end());
-    }
-}
-
-
-void linkInstMacro(DesignDB &db) {
-    for (auto &inst : db.instances) {
-        auto it = db.macros.find(inst.macro_name);
-        if (it == db.macros.end()) continue;
-        inst.macro_width  = it->second.width_dbu;
-        inst.macro_height = it->second.height_dbu;
-    }
-}
-
-
+    telemetry.emit(JsonLine("summary")
+        .field("initial_hpwl", initial_hpwl)
+        .field("final_hpwl", final_hpwl)
+        .field("algo_ms", std::chrono::duration<double, std::milli>(t_algo_end - t_algo_start).count())
+        .field("total_ms", std::chrono::duration<double, std::milli>(t_total_end - t_total_start).count())
+        .field("peak_rss_kb", peakRssKb()));
 
-void assignInstToRows(DesignDB &db) {
-    std::unordered_map<int,int> y2row;
-    for (int i = 0; i < (int)db.rows.size(); ++i) {
-        y2row[db.rows[i].y] = i;
-    }
-    for (int i = 0; i < (int)db.instances.size(); ++i) {
-        auto &inst = db.instances[i];
-        if (inst.is_fixed) continue;
-        auto it = y2row.find(inst.y);
-        if (it == y2row.end()) {
-            continue;
-        }
-        int row_id = it->second;
-        inst.row_id = row_id;
-        db.rows[row_id].cell_ids.push_back(i);
-    }
-    for (auto &row : db.rows) {
-        std::sort(row.cell_ids.begin(), row.cell_ids.end(),
-                  [&](int a, int b){
-                      return db.instances[a].x < db.instances[b].x;
-                  });
-    }
+    return 0;
 }
 
-
-
-
-void writeDEF(const DesignDB &db, const std::string &def_in_path, const std::string &def_out_path) {
-    std::ifstream fin(def_in_path);
-    if (!fin) {
-        std::cerr << "Error: Cannot open input DEF for writing: " << def_in_path << std::endl;
-        return;
-    }
-    std::ofstream fout(def_out_path);
-    if (!fout) {
-        std::cerr << "Error: Cannot open output DEF for writing: " << def_out_path << std::endl;
-        return;
-    }
-
-    std::string line;
-    bool in_components = false;
-    std::string pending_instName;
-
-    while (std::getline(fin, line)) {
-
-        std::stringstream ss(line);
-        std::string tok;
-        if (!(ss >> tok)) {
-            fout << line << "\n";
-            continue;
-        }
-
-
-        if (tok == "COMPONENTS") {
-            in_components = true;
-            fout << line << "\n";
-            continue;
-        } else if (tok == "END") {
-            std::string tok2;
-            ss >> tok2;
-            if (tok2 == "COMPONENTS") {
-                in_components = false;
-                pending_instName.clear();
-            }
-            fout << line << "\n";
-            continue;
-        }
-
-
-        if (!in_components) {
-            fout << line << "\n";
-            continue;
-        }
-
-
-
-        if (tok == "-") {
-            std::string instName, macroName;
-            ss >> instName >> macroName;
-            pending_instName = instName;
-
-            std::string rest_of_line;
-            std::getline(ss, rest_of_line);
-
-            if (rest_of_line.find("+ PLACED") != std::string::npos) {
-
-
-                pending_instName.clear();
-
-                auto it = db.inst_name_to_id.find(instName);
-                if (it == db.inst_name_to_id.end()) {
-                    fout << line << "\n";
-                } else {
-                    const auto& inst = db.instances[it->second];
-                    fout << "- " << instName << " " << macroName
-                         << " + PLACED ( " << inst.x << " " << inst.y
-                         << " ) " << inst.orient << " ;" << "\n";
-                }
-            }
-            else {
-
-
-
-
-                fout << line << "\n";
-
-
-            }
-        }
-        else if ( (tok == "+" || starts_with(tok, "+")) && !pending_instName.empty() ) {
-
-
-            std::string status;
-            if (tok == "+") ss >> status;
-            else status = tok.substr(1);
-
-            if (status == "PLACED") {
-
-                auto it = db.inst_name_to_id.find(pending_instName);
-                if (it == db.inst_name_to_id.end()) {
-                    fout << line << "\n";
-                } else {
-                    const auto& inst = db.instances[it->second];
-
-
-
-                    fout << "  + PLACED ( " << inst.x << " " << inst.y
-                         << " ) " << inst.orient;
-
-
-                    if (line.find(';') != std::string::npos) {
-                        fout << " ;";
-                        pending_instName.clear();
-                    }
-                    fout << "\n";
-                }
-            } else {
-
-
-                fout << line << "\n";
-            }
-        }
-        else if (in_components && tok == ";" && !pending_instName.empty()) {
-
-
-
-            fout << line << "\n";
-            pending_instName.clear();
-        }
-        else {
-
-
-
-
-
-
-
-            if (in_components && tok == ";" && pending_instName.empty()) {
-
-
-            } else {
-                fout << line << "\n";
-            }
-        }
-    }
-}
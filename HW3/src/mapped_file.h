@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only view of a whole file. The file is mmap'ed when possible and read
+// into a heap buffer otherwise (e.g. pipes or filesystems without mmap).
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                map = p;
+                len = (size_t)st.st_size;
+                ::close(fd);
+                return true;
+            }
+        }
+        char tmp[1 << 16];
+        ssize_t got;
+        while ((got = ::read(fd, tmp, sizeof(tmp))) > 0) fallback.insert(fallback.end(), tmp, tmp + got);
+        ::close(fd);
+        if (got < 0) return false;
+        len = fallback.size();
+        return true;
+    }
+
+    const char* data() const { return map ? (const char*)map : fallback.data(); }
+    size_t size() const { return len; }
+
+    void close() {
+        if (map) munmap(map, len);
+        map = nullptr;
+        len = 0;
+        fallback.clear();
+    }
+
+private:
+    void* map = nullptr;
+    size_t len = 0;
+    std::vector<char> fallback;
+};
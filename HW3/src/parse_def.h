@@ -1,362 +1,441 @@
 #pragma once
-#include <fstream>
-#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-
-
-static bool starts_with(const std::string &s, const std::string &prefix) {
-    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
-}
-
-void parseDEF(const std::string &def_path, DesignDB &db) {
-    std::ifstream fin(def_path);
-    if (!fin) {
-        std::cerr << "Cannot open DEF: " << def_path << "\n";
-        exit(1);
+#include <string>
+#include "db.h"
+#include "mapped_file.h"
+#include "string_pool.h"
+#include "thread_pool.h"
+
+// Tokenizer over an in-memory DEF image. Tokens are whitespace-separated views
+// into the buffer, so nothing is copied until a name is interned. '#' starts a
+// comment, a quoted string is one token, and a ';' glued to the end of a word
+// is split off; records therefore parse the same however they are broken
+// across lines.
+class DefLexer {
+public:
+    // file_begin anchors offsets and line numbers when [begin, end) is only
+    // one chunk of the file.
+    DefLexer(const char* begin, const char* end, const char* file_begin = nullptr)
+        : p(begin), e(end), base(file_begin ? file_begin : begin) {}
+
+    bool next(StrRef &tok) {
+        for (;;) {
+            while (p < e && isSpace(*p)) ++p;
+            if (p == e) return false;
+            if (*p != '#') break;
+            while (p < e && *p != '\n') ++p;
+        }
+        const char* s = p;
+        if (*p == '"') {
+            ++p;
+            while (p < e && *p != '"') p += (*p == '\\' && p + 1 < e) ? 2 : 1;
+            if (p < e) ++p;
+        } else {
+            while (p < e && !isSpace(*p)) ++p;
+            if (p - s > 1 && p[-1] == ';') --p;
+        }
+        tok = StrRef(s, (uint32_t)(p - s));
+        return true;
     }
 
-    std::string line;
-    bool in_components = false;
-    bool in_nets = false;
-    bool in_pins = false;
-
-    Inst cur_inst;
-    bool pending_inst = false;
-
-    Net cur_net;
-    bool pending_net = false;
-
-
-    while (std::getline(fin, line)) {
-        std::stringstream ss(line);
-        std::string tok;
-
-
-        if (!(ss >> tok)) continue;
-
-
-
-
+    const char* pos() const { return p; }
+    void seek(const char* at) { p = at; }
+    size_t offsetOf(const char* at) const { return (size_t)(at - base); }
 
+    // Consumes tokens up to and including the ';' that ends the statement.
+    void skipStatement() {
+        StrRef tok;
+        while (next(tok) && tok != ";") {}
+    }
 
-        if (tok == "UNITS") {
+    int nextInt() {
+        StrRef tok;
+        if (!next(tok)) fail("unexpected end of file");
+        return toInt(tok);
+    }
 
-            std::string t2;
-            while (ss >> t2) {
-                if (t2 == "DISTANCE") {
-                    std::string t3; int n;
-                    ss >> t3 >> n;
-                    db.def_dbu_per_micron = n;
-                    break;
-                }
-            }
-        }
+    // "( x y )"
+    void nextPoint(int &x, int &y) {
+        expect("(");
+        x = nextInt();
+        y = nextInt();
+        expect(")");
+    }
 
-        else if (tok == "ROW") {
+    void expect(const char* lit) {
+        StrRef tok;
+        if (!next(tok) || tok != lit) fail(std::string("expected '") + lit + "'");
+    }
 
-            Row row;
-            ss >> row.name >> row.site_name >> row.x >> row.y >> row.orient;
-            std::string tmp;
-            int do_cnt, by_cnt;
-            ss >> tmp >> do_cnt >> tmp >> by_cnt >> tmp >> row.step_x;
-            int step_y;
-            ss >> step_y;
-            row.site_count = do_cnt;
-            db.rows.push_back(row);
+    int toInt(StrRef tok) {
+        const char* s = tok.p;
+        const char* end = tok.p + tok.n;
+        bool neg = (s < end && *s == '-');
+        if (s < end && (*s == '-' || *s == '+')) ++s;
+        if (s == end) fail("expected a number, got '" + tok.str() + "'");
+        long long v = 0;
+        const char* d = s;
+        while (d < end && *d >= '0' && *d <= '9') v = v * 10 + (*d++ - '0');
+        if (d != end) {
+            // Not a plain integer (e.g. "100.0"): let strtod decide.
+            std::string text = tok.str();
+            char* stop = nullptr;
+            double r = std::strtod(text.c_str(), &stop);
+            if (stop != text.c_str() + text.size()) fail("expected a number, got '" + text + "'");
+            return (int)std::llround(r);
         }
+        return (int)(neg ? -v : v);
+    }
 
-        else if (tok == "PINS") {
-            in_pins = true;
-            continue;
-        } else if (tok == "END" && in_pins) {
-            std::string sec;
-            ss >> sec;
-            if (sec == "PINS") {
-                in_pins = false;
-            }
-        }
+    void fail(const std::string &msg) const {
+        std::cerr << "[DEF] Parse error near line " << lineOf(p) << ": " << msg << "\n";
+        exit(1);
+    }
 
-        else if (tok == "COMPONENTS") {
-            in_components = true;
-            continue;
-        } else if (tok == "END" && in_components) {
-            std::string sec;
-            ss >> sec;
-            if (sec == "COMPONENTS") {
-                in_components = false;
+    static bool isSpace(char c) {
+        // ' ' and '\t'..'\r'; one compare for every byte above the space.
+        return (unsigned char)c <= ' ' && (c == ' ' || (c >= '\t' && c <= '\r'));
+    }
 
+private:
+    const char* p;
+    const char* e;
+    const char* base;
 
+    int lineOf(const char* at) const {
+        int line = 1;
+        for (const char* q = base; q < at; ++q) line += (*q == '\n');
+        return line;
+    }
+};
+
+// Reads "+ STATUS" options: returns the status word of a "+" token ("+" then
+// the next token, or the glued form "+PLACED"), or an empty ref otherwise.
+static StrRef defOptionName(DefLexer &lex, StrRef tok) {
+    if (tok == "+") {
+        StrRef opt;
+        return lex.next(opt) ? opt : StrRef();
+    }
+    if (tok.n > 1 && tok.p[0] == '+') return StrRef(tok.p + 1, tok.n - 1);
+    return StrRef();
+}
 
+static bool isPlacementStatus(StrRef s) {
+    return s == "PLACED" || s == "FIXED" || s == "COVER";
+}
 
-                if (pending_inst) {
-                    int id = (int)db.instances.size();
-                    db.inst_name_to_id[cur_inst.name] = id;
-                    db.instances.push_back(cur_inst);
-                    pending_inst = false;
-                }
+// "PINS n ;" up to "END PINS". Only the name and the first placement of each
+// pin are kept.
+static void parseDefPins(DefLexer &lex, DesignDB &db) {
+    db.io_pins.reserve(db.io_pins.size() + std::max(0, lex.nextInt()));
+    lex.skipStatement();
+    StrRef tok;
+    while (lex.next(tok)) {
+        if (tok == "END") { lex.next(tok); return; }
+        if (tok != "-") { lex.skipStatement(); continue; }
+
+        IOPin pin;
+        if (!lex.next(tok)) break;
+        pin.name = db.names.intern(tok);
+        bool placed = false;
+        while (lex.next(tok) && tok != ";") {
+            StrRef opt = defOptionName(lex, tok);
+            if (!placed && isPlacementStatus(opt)) {
+                lex.nextPoint(pin.x, pin.y);
+                if (lex.next(tok)) pin.orient = tok.str();
+                placed = true;
             }
         }
-
-        else if (tok == "NETS") {
-            in_nets = true;
-            continue;
-        } else if (tok == "END" && in_nets) {
-            std::string sec;
-            ss >> sec;
-            if (sec == "NETS") {
-                in_nets = false;
-
-
+        if (pin.name >= (int)db.io_pin_of_name.size()) db.io_pin_of_name.resize(pin.name + 1, -1);
+        db.io_pin_of_name[pin.name] = (int)db.io_pins.size();
+        db.io_pins.push_back(pin);
+    }
+}
 
 
-                if (pending_net) {
-                    db.net_name_to_id[cur_net.name] = (int)db.nets.size();
-                    db.nets.push_back(cur_net);
-                    pending_net = false;
-                }
-            }
+// Section bodies are parsed in two steps: chunks of whole records are read
+// in parallel into the buffers below, which hold names as views into the
+// file, then merged serially in file order. The merge interns names in the
+// same order a single pass would, so ids do not depend on the thread count.
+struct DefName {
+    StrRef s;
+    uint32_t hash;
+};
+
+struct DefComponentChunk {
+    std::vector<Inst> insts;
+    std::vector<DefName> names, macros;
+    std::vector<DesignDB::DefPlacement> placements;  // inst_id is chunk-local
+};
+
+struct DefNetChunk {
+    std::vector<Net> nets;       // name indexes net_names; pin names index pin_names
+    std::vector<DefName> net_names;
+    StringPool pin_names;
+    std::vector<DefName> inst_refs;  // while parsing, NetPin::inst_id indexes this
+};
+
+// Splits a section body into about `parts` ranges that each start at a
+// record: a line whose first token is "-". Ranges only decide where work is
+// cut; records are still read by the tokenizer, so a body without such line
+// starts simply stays one range.
+static std::vector<std::pair<const char*, const char*>>
+splitDefRecords(const char* begin, const char* end, int parts) {
+    std::vector<std::pair<const char*, const char*>> ranges;
+    const char* from = begin;
+    for (int k = 1; k < parts; ++k) {
+        const char* p = begin + (end - begin) * k / parts;
+        if (p <= from) continue;
+        while (p < end) {
+            while (p < end && *p != '\n') ++p;
+            while (p < end && (*p == '\n' || *p == ' ' || *p == '\t' || *p == '\r')) ++p;
+            if (p + 1 < end && p[0] == '-' && (p[1] == ' ' || p[1] == '\t')) break;
         }
+        if (p >= end) break;
+        ranges.push_back({from, p});
+        from = p;
+    }
+    ranges.push_back({from, end});
+    return ranges;
+}
 
+// Start of the "END <section>" that closes a body beginning at `from`, or
+// `end` if there is none.
+static const char* findDefSectionEnd(const char* from, const char* end, const char* section) {
+    size_t len = std::strlen(section);
+    const char* p = from;
+    while (p < end) {
+        const char* hit = (const char*)memmem(p, end - p, section, len);
+        if (!hit) break;
+        p = hit + len;
+        if (p < end && !DefLexer::isSpace(*p) && *p != ';') continue;
+        const char* q = hit;
+        if (q == from || !DefLexer::isSpace(q[-1])) continue;
+        while (q > from && DefLexer::isSpace(q[-1])) --q;
+        if (q - from >= 3 && std::memcmp(q - 3, "END", 3) == 0 &&
+            (q - 3 == from || DefLexer::isSpace(q[-4]))) return q - 3;
+    }
+    return end;
+}
 
-        else if (in_pins && tok == "-") {
-
-            IOPin pin;
-            ss >> pin.name;
-            bool placed_found = false;
-
-            {
-                std::string t2;
-                while (ss >> t2) {
-                    if (t2 == "+") {
-                        std::string t3;
-                        if (!(ss >> t3)) break;
-                        if (t3 == "PLACED") {
-                            std::string lp, rp;
-                            ss >> lp >> pin.x >> pin.y >> rp >> pin.orient;
-                            placed_found = true;
-                            break;
-                        }
-                    }
-                }
-            }
-
-            while (!placed_found && std::getline(fin, line)) {
-                std::stringstream s2(line);
-                std::string t2;
-                if (!(s2 >> t2)) continue;
-                if (t2 == "+") {
-                    std::string t3;
-                    if (!(s2 >> t3)) continue;
-                    if (t3 == "PLACED") {
-                        std::string lp, rp;
-                        s2 >> lp >> pin.x >> pin.y >> rp >> pin.orient;
-                        placed_found = true;
-                    }
+// "- name macro [+ PLACED|FIXED|COVER ( x y ) orient] [+ ...] ;" records.
+static void parseDefComponents(DefLexer &lex, DefComponentChunk &out) {
+    StrRef tok, name, macro;
+    while (lex.next(tok)) {
+        if (tok != "-") { lex.skipStatement(); continue; }
+        if (!lex.next(name) || !lex.next(macro)) break;
+
+        Inst inst;
+        while (lex.next(tok) && tok != ";") {
+            StrRef opt = defOptionName(lex, tok);
+            if (isPlacementStatus(opt)) {
+                const char* loc = lex.pos();
+                if (opt != "PLACED") inst.is_fixed = true;
+                lex.nextPoint(inst.x, inst.y);
+                if (lex.next(tok) && !parseOrient(tok, inst.orient)) {
+                    lex.fail("unknown orientation '" + tok.str() + "'");
                 }
-                if (line.find(';') != std::string::npos) {
-                    break;
+                if (!inst.is_fixed) {
+                    out.placements.push_back({lex.offsetOf(loc), lex.offsetOf(tok.p + tok.n),
+                                              (int)out.insts.size()});
                 }
             }
-            db.io_pins[pin.name] = pin;
-        }
-
-        else if (tok == "DIEAREA") {
-            std::string lp1, rp1, lp2, rp2;
-            ss >> lp1 >> db.die_x_min >> db.die_y_min >> rp1;
-            ss >> lp2 >> db.die_x_max >> db.die_y_max >> rp2;
-
-
-            db.die_x_min = 0;
-            db.die_y_min = 0;
-
-            std::cout << "[DEF] Parsed DIEAREA: (0, 0) to ("
-                      << db.die_x_max << ", " << db.die_y_max << ")" << std::endl;
         }
+        out.names.push_back({name, StringPool::hash(name)});
+        out.macros.push_back({macro, StringPool::hash(macro)});
+        out.insts.push_back(inst);
+    }
+}
 
-
-
-        else if (tok == "COMPONENTS") {
-            in_components = true;
-            continue;
-        } else if (tok == "END" && in_components) {
-            std::string sec;
-            ss >> sec;
-            if (sec == "COMPONENTS") {
-                in_components = false;
-
-
-
-
-                if (pending_inst) {
-                    int id = (int)db.instances.size();
-                    db.inst_name_to_id[cur_inst.name] = id;
-                    db.instances.push_back(cur_inst);
-                    pending_inst = false;
-                }
-            }
+static void mergeDefComponents(std::vector<DefComponentChunk> &chunks, DesignDB &db) {
+    size_t total = 0;
+    for (const auto &c : chunks) total += c.insts.size();
+    db.instances.reserve(db.instances.size() + total);
+    db.inst_info.reserve(db.inst_info.size() + total);
+    db.inst_names.reserve(db.inst_names.size() + total);
+    db.inst_of_name.reserve(db.inst_of_name.size() + total);
+
+    for (auto &c : chunks) {
+        int first = (int)db.instances.size();
+        for (size_t k = 0; k < c.insts.size(); ++k) {
+            // A repeated component name refers to the last definition.
+            int name_id = db.inst_names.intern(c.names[k].s, c.names[k].hash);
+            if (name_id == (int)db.inst_of_name.size()) db.inst_of_name.push_back((int)db.instances.size());
+            else db.inst_of_name[name_id] = (int)db.instances.size();
+            InstInfo info;
+            info.name = name_id;
+            info.macro = db.macro_names.intern(c.macros[k].s, c.macros[k].hash);
+            db.inst_info.push_back(info);
+            db.instances.push_back(c.insts[k]);
         }
-
-
-
-        else if (in_components && tok == "-") {
-
-            if (pending_inst) {
-                int id = (int)db.instances.size();
-                db.inst_name_to_id[cur_inst.name] = id;
-                db.instances.push_back(cur_inst);
-
-            }
-
-
-            cur_inst = Inst();
-            ss >> cur_inst.name >> cur_inst.macro_name;
-            pending_inst = true;
-
-
-            std::string tok_inner;
-            while (ss >> tok_inner) {
-                std::string status;
-                if (tok_inner == "+") {
-                    ss >> status;
-                } else if (starts_with(tok_inner, "+")) {
-                    status = tok_inner.substr(1);
-                } else {
-                    continue;
-                }
-
-                if (status == "PLACED" || status == "FIXED") {
-                    if (status == "FIXED") cur_inst.is_fixed = true;
-                    std::string lparen, rparen;
-                    ss >> lparen >> cur_inst.x >> cur_inst.y >> rparen >> cur_inst.orient;
-                    break;
-                }
-            }
+        for (auto loc : c.placements) {
+            loc.inst_id += first;
+            db.def_placements.push_back(loc);
         }
-        else if (in_components && pending_inst &&
-                 (tok == "+" || starts_with(tok, "+"))) {
-
-
-
-
-
-
-
-
+    }
+}
 
-            std::string status;
-            if (tok == "+") {
-                ss >> status;
+// "- name ( inst pin ) ( PIN port ) ... [+ ...] ;" records. Connections are
+// the groups before the first "+" option; routing geometry after it is
+// skipped. Instance names are resolved here, so components must be merged.
+static void parseDefNets(DefLexer &lex, const DesignDB &db, DefNetChunk &out) {
+    StrRef tok, a, b;
+    while (lex.next(tok)) {
+        if (tok != "-") { lex.skipStatement(); continue; }
+        if (!lex.next(tok)) break;
+
+        Net net;
+        net.name = (int)out.net_names.size();
+        out.net_names.push_back({tok, StringPool::hash(tok)});
+        bool in_options = false;
+        while (lex.next(tok) && tok != ";") {
+            if (in_options) continue;
+            if (tok.p[0] == '+') { in_options = true; continue; }
+            if (tok != "(") continue;
+            if (!lex.next(a) || !lex.next(b)) break;
+            while (lex.next(tok) && tok != ")") {}  // e.g. "+ SYNTHESIZED"
+
+            NetPin pin;
+            if (a == "PIN") {
+                pin.is_port = true;
+                pin.port_name = out.pin_names.intern(b);
             } else {
-                status = tok.substr(1);
-            }
-
-            if (status == "PLACED" || status == "FIXED") {
-                if (status == "FIXED") cur_inst.is_fixed = true;
-                std::string lparen, rparen;
-                ss >> lparen >> cur_inst.x >> cur_inst.y >> rparen >> cur_inst.orient;
+                pin.is_port = false;
+                pin.inst_id = (int)out.inst_refs.size();
+                out.inst_refs.push_back({a, StringPool::hash(a)});
+                pin.pin_name = out.pin_names.intern(b);
             }
+            net.pins.push_back(pin);
         }
+        out.nets.push_back(std::move(net));
+    }
 
+    // Instance lookups are random accesses into a table much larger than the
+    // cache; resolving them in one loop lets the next slots be prefetched.
+    const int kAhead = 16;
+    const int num_refs = (int)out.inst_refs.size();
+    std::vector<int> inst_of_ref(num_refs);
+    for (int k = 0; k < num_refs; ++k) {
+        if (k + kAhead < num_refs) db.inst_names.prefetch(out.inst_refs[k + kAhead].hash);
+        int name_id = db.inst_names.find(out.inst_refs[k].s, out.inst_refs[k].hash);
+        inst_of_ref[k] = name_id < 0 ? -1 : db.inst_of_name[name_id];
+    }
+    for (auto &net : out.nets) {
+        for (auto &pin : net.pins) {
+            if (!pin.is_port) pin.inst_id = inst_of_ref[pin.inst_id];
+        }
+    }
+}
 
-
-
-        else if (in_nets && tok == "-") {
-
-            if (pending_net) {
-                db.net_name_to_id[cur_net.name] = (int)db.nets.size();
-                db.nets.push_back(cur_net);
-                pending_net = false;
-            }
-            cur_net = Net();
-            ss >> cur_net.name;
-            pending_net = true;
-
-
-            std::string tok_inner;
-            while (ss >> tok_inner) {
-                if (tok_inner == "(") {
-                    std::string name1, name2, rparen;
-                    ss >> name1 >> name2 >> rparen;
-                    NetPin pin;
-                    if (name1 == "PIN") {
-                        pin.is_port = true; pin.port_name = name2;
-                    } else {
-                        pin.is_port = false;
-                        auto it = db.inst_name_to_id.find(name1);
-                        pin.inst_id = (it != db.inst_name_to_id.end()) ? it->second : -1;
-                        pin.pin_name = name2;
-                    }
-                    cur_net.pins.push_back(pin);
-                }
+static void mergeDefNets(std::vector<DefNetChunk> &chunks, DesignDB &db) {
+    size_t total = 0;
+    for (const auto &c : chunks) total += c.nets.size();
+    db.nets.reserve(db.nets.size() + total);
+
+    std::vector<int> global;
+    for (auto &c : chunks) {
+        global.assign(c.pin_names.size(), -1);
+        auto resolve = [&](int local) {
+            int &g = global[local];
+            if (g < 0) g = db.names.intern(c.pin_names.get(local), c.pin_names.hashAt(local));
+            return g;
+        };
+        for (auto &net : c.nets) {
+            net.name = db.names.intern(c.net_names[net.name].s, c.net_names[net.name].hash);
+            for (auto &pin : net.pins) {
+                if (pin.is_port) pin.port_name = resolve(pin.port_name);
+                else pin.pin_name = resolve(pin.pin_name);
             }
+            db.nets.push_back(std::move(net));
         }
-        else if (in_nets && pending_net && tok == "(") {
+    }
+}
 
+// Parses one COMPONENTS or NETS body (after its "NAME n ;" header) in chunks
+// on `pool`, then merges. Returns the end of the body.
+template <typename Chunk, typename ParseFn, typename MergeFn>
+static const char* parseDefSection(DefLexer &lex, const MappedFile &file, const char* section,
+                                   ThreadPool &pool, ParseFn parse, MergeFn merge) {
+    const char* file_end = file.data() + file.size();
+    const char* begin = lex.pos();
+    const char* end = findDefSectionEnd(begin, file_end, section);
+
+    // Small bodies are not worth splitting; 256 KB chunks keep merge cheap.
+    const size_t kMinChunk = 1 << 18;
+    int parts = pool.size() > 1 ? (int)std::min<size_t>(pool.size() * 4, (end - begin) / kMinChunk) : 1;
+    auto ranges = splitDefRecords(begin, end, std::max(1, parts));
+
+    std::vector<Chunk> chunks(ranges.size());
+    pool.parallelFor((int)ranges.size(), [&](int k, int) {
+        DefLexer chunk_lex(ranges[k].first, ranges[k].second, file.data());
+        parse(chunk_lex, chunks[k]);
+    });
+    merge(chunks);
+    return end;
+}
 
+void parseDEF(const std::string &def_path, DesignDB &db, int num_threads = 1) {
+    MappedFile file;
+    if (!file.open(def_path)) {
+        std::cerr << "Cannot open DEF: " << def_path << "\n";
+        exit(1);
+    }
+    ThreadPool pool(std::max(1, num_threads));
 
-            {
-                std::string name1, name2, rparen;
-                ss >> name1 >> name2 >> rparen;
-                NetPin pin;
-                if (name1 == "PIN") {
-                    pin.is_port = true; pin.port_name = name2;
-                } else {
-                    pin.is_port = false;
-                    auto it = db.inst_name_to_id.find(name1);
-                    pin.inst_id = (it != db.inst_name_to_id.end()) ? it->second : -1;
-                    pin.pin_name = name2;
-                }
-                cur_net.pins.push_back(pin);
+    db.def_size = file.size();
+    DefLexer lex(file.data(), file.data() + file.size());
+    StrRef tok;
+    while (lex.next(tok)) {
+        if (tok == "UNITS") {
+            // UNITS DISTANCE MICRONS n ;
+            StrRef t2;
+            if (lex.next(t2) && t2 == "DISTANCE" && lex.next(t2)) db.def_dbu_per_micron = lex.nextInt();
+            lex.skipStatement();
+        }
+        else if (tok == "ROW") {
+            // ROW name site x y orient [DO n BY m [STEP sx sy]] ;
+            Row row;
+            StrRef t2;
+            if (lex.next(t2)) row.name = t2.str();
+            if (lex.next(t2)) row.site_name = t2.str();
+            row.x = lex.nextInt();
+            row.y = lex.nextInt();
+            if (lex.next(t2) && !parseOrient(t2, row.orient)) {
+                lex.fail("unknown orientation '" + t2.str() + "'");
             }
-
-
-            std::string tok_inner;
-            while (ss >> tok_inner) {
-                if (tok_inner == "(") {
-                    std::string name1, name2, rparen;
-                    ss >> name1 >> name2 >> rparen;
-                    NetPin pin;
-                    if (name1 == "PIN") {
-                        pin.is_port = true; pin.port_name = name2;
-                    } else {
-                        pin.is_port = false;
-                        auto it = db.inst_name_to_id.find(name1);
-                        pin.inst_id = (it != db.inst_name_to_id.end()) ? it->second : -1;
-                        pin.pin_name = name2;
-                    }
-                    cur_net.pins.push_back(pin);
-                }
+            while (lex.next(t2) && t2 != ";") {
+                if (t2 == "DO") row.site_count = lex.nextInt();
+                else if (t2 == "STEP") row.step_x = lex.nextInt();
             }
+            db.rows.push_back(row);
         }
-        else if (in_nets && pending_net && tok == ";") {
-
-
-
+        else if (tok == "DIEAREA") {
+            lex.nextPoint(db.die_x_min, db.die_y_min);
+            lex.nextPoint(db.die_x_max, db.die_y_max);
+            lex.skipStatement();
 
 
+            db.die_x_min = 0;
+            db.die_y_min = 0;
         }
-
-    }
-
-
-
-
-    /*
-    if (pending_inst) {
-        int id = (int)db.instances.size();
-        db.inst_name_to_id[cur_inst.name] = id;
-        db.instances.push_back(cur_inst);
-    }
-    if (pending_net) {
-        db.net_name_to_id[cur_net.name] = (int)db.nets.size();
-        db.nets.push_back(cur_net);
+        else if (tok == "PINS") parseDefPins(lex, db);
+        else if (tok == "COMPONENTS") {
+            lex.skipStatement();
+            lex.seek(parseDefSection<DefComponentChunk>(lex, file, "COMPONENTS", pool,
+                [](DefLexer &l, DefComponentChunk &c) { parseDefComponents(l, c); },
+                [&](std::vector<DefComponentChunk> &cs) { mergeDefComponents(cs, db); }));
+        }
+        else if (tok == "NETS") {
+            lex.skipStatement();
+            lex.seek(parseDefSection<DefNetChunk>(lex, file, "NETS", pool,
+                [&](DefLexer &l, DefNetChunk &c) { parseDefNets(l, db, c); },
+                [&](std::vector<DefNetChunk> &cs) { mergeDefNets(cs, db); }));
+        }
+        else if (tok == "END") lex.next(tok);  // END <section> / END DESIGN carry no ';'
+        else lex.skipStatement();
     }
-    */
-
-    std::cerr << "[DEF] dbu_per_micron=" << db.def_dbu_per_micron
-              << " rows=" << db.rows.size()
-              << " insts=" << db.instances.size()
-              << " nets=" << db.nets.size()
-              << " io_pins=" << db.io_pins.size()
-              << "\n";
-}
\ No newline at end of file
+    db.io_pin_of_name.resize(db.names.size(), -1);
+}
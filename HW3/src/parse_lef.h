@@ -114,10 +114,4 @@ void parseLEF(const std::string &lef_path, DesignDB &db) {
             }
         }
     }
-
-    std::cerr << "[LEF] dbu_per_micron=" << db.lef_dbu_per_micron
-              << " macros=" << db.macros.size()
-              << " sites=" << db.sites.size()
-              << " (core_site_width=" << db.core_site_width_dbu << " dbu)"
-              << "\n";
 }
\ No newline at end of file
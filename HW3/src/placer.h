@@ -1,51 +1,290 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <limits>
-#include <set>
 #include <unordered_map>
 #include <vector>
 #include <map>
+#include <type_traits>
 #include "db.h"
+#include "free_space.h"
+#include "thread_pool.h"
+#include "assignment.h"
+#include "global_place.h"
+#include "hpwl.h"
+#include "legalize.h"
 
 void assignInstToRows(DesignDB &db);
 
+// Reusable net-id set for move evaluation: a timestamped mark array plus a
+// flat id list. clear() is O(1), so collecting the nets of a candidate move
+// does not touch the heap once the list has reached its working size.
+class NetScratch {
+public:
+    void init(int num_nets) {
+        stamp.assign(num_nets, 0);
+        cur = 1;
+        ids.clear();
+        ids.reserve(256);
+    }
+
+    void clear() {
+        ids.clear();
+        if (++cur == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            cur = 1;
+        }
+    }
+
+    void add(Span<uint32_t> nets) {
+        for (uint32_t n : nets) {
+            if (stamp[n] == cur) continue;
+            stamp[n] = cur;
+            ids.push_back(n);
+        }
+    }
+
+    Span<uint32_t> span() const { return Span<uint32_t>(ids.data(), ids.data() + ids.size()); }
+    bool empty() const { return ids.empty(); }
+
+private:
+    std::vector<uint32_t> stamp;
+    uint32_t cur = 1;
+    std::vector<uint32_t> ids;
+};
+
+// Work counters of the improvement passes. They only grow; a caller that
+// wants the cost of one pass takes the difference around it.
+struct PassCounters {
+    long long moves_evaluated = 0;  // candidate moves costed
+    long long moves_accepted = 0;   // moves committed to the placement
+    long long hpwl_evals = 0;       // per-net HPWL / bounding-box computations
+    long long pins_scanned = 0;     // pins read by those computations
+
+    PassCounters& operator+=(const PassCounters& o) {
+        moves_evaluated += o.moves_evaluated;
+        moves_accepted += o.moves_accepted;
+        hpwl_evals += o.hpwl_evals;
+        pins_scanned += o.pins_scanned;
+        return *this;
+    }
+    PassCounters operator-(const PassCounters& o) const {
+        PassCounters d;
+        d.moves_evaluated = moves_evaluated - o.moves_evaluated;
+        d.moves_accepted = moves_accepted - o.moves_accepted;
+        d.hpwl_evals = hpwl_evals - o.hpwl_evals;
+        d.pins_scanned = pins_scanned - o.pins_scanned;
+        return d;
+    }
+};
+
 class Placer {
+public:
+    using DeadlineClock = std::chrono::steady_clock;
+
 private:
     DesignDB& db;
-    std::unordered_map<int, std::set<int>> inst_to_nets_map;
+    const NetlistView& nl;
+    // Spatial index for candidate generation. Once built it follows every
+    // committed move; bulk moves (legalization, global placement, a full row
+    // rebuild) clear grid_synced and the next pass that needs it rebuilds it.
     BinGrid grid;
+    bool grid_synced = false;
+    // Extremes of the nets of at least wide_net_degree pins. Kept current
+    // and invalidated the same way as the grid.
+    WideNetIndex wide_nets;
+    bool wide_synced = false;
+    int wide_net_degree = 32;
+    RowIndex row_index;
+    // True while every movable cell sits in row.cells of its row_id under its
+    // current x. Passes that move cells without updating the rows clear it.
+    bool rows_synced = false;
+    // Free-site index per row, kept in step with row membership by the
+    // insertion passes; passes that move cells without updating it clear
+    // space_synced so the next rebuildRowCellIds() recomputes it.
+    std::vector<RowFreeSpace> row_space;
+    int space_site_width = 200;
+    bool space_synced = false;
+
+    int pinX(int32_t ref) const { return ref >= 0 ? db.instances[ref].x : nl.io_x[~ref]; }
+    int pinY(int32_t ref) const { return ref >= 0 ? db.instances[ref].y : nl.io_y[~ref]; }
+
+    void pinPos(int32_t ref, int& x, int& y) const {
+        if (ref >= 0) {
+            const Inst& c = db.instances[ref];
+            x = c.x;
+            y = c.y;
+        } else {
+            x = nl.io_x[~ref];
+            y = nl.io_y[~ref];
+        }
+    }
 
-    long long calculatePartialHPWL(const std::set<int> &affected_net_ids) {
-        long long partial_hpwl = 0;
-        for (int net_id : affected_net_ids) {
-            const auto &net = db.nets[net_id];
-            if (net.pins.empty()) continue;
-            long long min_x = std::numeric_limits<long long>::max();
-            long long max_x = std::numeric_limits<long long>::min();
-            long long min_y = std::numeric_limits<long long>::max();
-            long long max_y = std::numeric_limits<long long>::min();
-            bool found = false;
-            for (const auto &pin : net.pins) {
-                long long px = 0, py = 0;
-                bool ok = false;
-                if (pin.is_port) {
-                    auto it = db.io_pins.find(pin.port_name);
-                    if (it != db.io_pins.end()) { px = it->second.x; py = it->second.y; ok = true; }
-                } else if (pin.inst_id >= 0 && pin.inst_id < (int)db.instances.size()) {
-                    const auto &inst = db.instances[pin.inst_id];
-                    px = inst.x; py = inst.y; ok = true;
-                }
-                if (ok) {
-                    min_x = std::min(min_x, px); max_x = std::max(max_x, px);
-                    min_y = std::min(min_y, py); max_y = std::max(max_y, py);
-                    found = true;
-                }
+    // Position source for net_table reading the current placement.
+    struct PlacedPos {
+        const Placer* placer;
+        void operator()(int32_t ref, int& x, int& y) const { placer->pinPos(ref, x, y); }
+    };
+
+    // Every move evaluator costs nets through net_table, which has its own
+    // kernels for 2- and 3-pin nets.
+    NetDegreeTable net_table;
+
+    // Cells a and b at new positions for NetDegreeTable::spanDelta. Refs
+    // are compared without branching; kNone matches no pin.
+    struct MovedPos {
+        int a, ax, ay, b, bx, by;
+        void operator()(int32_t ref, int& x, int& y) const {
+            bool is_a = ref == a, is_b = ref == b;
+            x = is_a ? ax : (is_b ? bx : x);
+            y = is_a ? ay : (is_b ? by : y);
+        }
+    };
+
+    template <typename Pos>
+    long long netsDelta(Span<uint32_t> nets, const Pos& pos, const MovedPos& moved, PassCounters& c) const {
+        long long delta = 0;
+        for (uint32_t net : nets) delta += net_table.spanDelta(net, pos, moved, c.pins_scanned);
+        c.hpwl_evals += nets.size();
+        return delta;
+    }
+
+    // HPWL change of nets with cell a moved to (ax, ay) and cell b to
+    // (bx, by); b may be -1 for none. Reads the placement without changing it.
+    long long movedDelta(Span<uint32_t> nets, int a, int ax, int ay, int b, int bx, int by, PassCounters& c) const {
+        const int kNone = std::numeric_limits<int>::min();
+        const PlacedPos placed{this};
+        const MovedPos moved{a, ax, ay, b >= 0 ? b : kNone, bx, by};
+        long long delta = 0;
+        for (uint32_t net : nets) {
+            long long d;
+            if (!wide_synced || !wide_nets.wide(net) || !wide_nets.delta(net, a, ax, ay, b, bx, by, d))
+                d = net_table.spanDelta(net, placed, moved, c.pins_scanned);
+            delta += d;
+        }
+        c.hpwl_evals += nets.size();
+        return delta;
+    }
+
+    // Box of net over the pins of cells other than skip, at their current
+    // positions. Returns false if there are none.
+    bool placedBoxWithout(uint32_t net, int skip, int& lo_x, int& hi_x, int& lo_y, int& hi_y, PassCounters& c) const {
+        if (wide_synced && wide_nets.wide(net) && wide_nets.boxWithout(net, skip, lo_x, hi_x, lo_y, hi_y)) return true;
+        return net_table.boxWithout(net, skip, PlacedPos{this}, lo_x, hi_x, lo_y, hi_y, c.pins_scanned);
+    }
+
+    // Nets touched by the move under evaluation, plus per-pass buffers that
+    // are reused across candidates instead of being rebuilt per move.
+    NetScratch affected;
+    PassCounters counters;
+
+    // Box of each net of inst_id over the net's other pins, four ints per
+    // net (x_lo, x_hi, y_lo, y_hi). A net with no other pin gets the empty
+    // box (max, min), which boxedHPWL costs as 0.
+    template <typename Pos>
+    void collectNetBoxes(int inst_id, Span<uint32_t> nets, const Pos& pos, std::vector<int>& box,
+                         PassCounters& c) const {
+        box.resize(4 * nets.size());
+        int* b = box.data();
+        const bool placed = std::is_same<Pos, PlacedPos>::value;
+        for (uint32_t net_id : nets) {
+            if (placed) placedBoxWithout(net_id, inst_id, b[0], b[1], b[2], b[3], c);
+            else net_table.boxWithout(net_id, inst_id, pos, b[0], b[1], b[2], b[3], c.pins_scanned);
+            b += 4;
+        }
+        c.hpwl_evals += nets.size();
+    }
+
+    // HPWL of the nets boxed by collectNetBoxes with their cell at (x, y).
+    // It costs O(nets) whatever their degree, so every candidate position
+    // of a cell after the first is cheap.
+    static long long boxedHPWL(const std::vector<int>& box, int x, int y) {
+        long long total = 0;
+        for (size_t k = 0; k < box.size(); k += 4) {
+            total += (long long)std::max(box[k + 1], x) - std::min(box[k], x);
+            total += (long long)std::max(box[k + 3], y) - std::min(box[k + 2], y);
+        }
+        return total;
+    }
+
+    // Sorted edges of the non-empty boxes; their medians bound the optimal
+    // region of the cell.
+    static void optimalRegionEdges(const std::vector<int>& box, std::vector<int>& xs, std::vector<int>& ys) {
+        xs.clear();
+        ys.clear();
+        for (size_t k = 0; k < box.size(); k += 4) {
+            if (box[k] > box[k + 1]) continue;
+            xs.push_back(box[k]); xs.push_back(box[k + 1]);
+            ys.push_back(box[k + 2]); ys.push_back(box[k + 3]);
+        }
+        std::sort(xs.begin(), xs.end());
+        std::sort(ys.begin(), ys.end());
+    }
+
+    // Site range [s0, s1) of row_id covered by the dbu interval [x0, x1).
+    void siteRange(int row_id, long long x0, long long x1, int site_width, int& s0, int& s1) const {
+        long long left = row_index.spanLeft(row_id);
+        long long r0 = x0 - left, r1 = x1 - left;
+        s0 = (int)(r0 >= 0 ? r0 / site_width : -((-r0 + site_width - 1) / site_width));
+        s1 = (int)(r1 >= 0 ? (r1 + site_width - 1) / site_width : -((-r1) / site_width));
+    }
+
+    void occupySpace(int inst_id) {
+        const Inst& inst = db.instances[inst_id];
+        if (inst.row_id < 0) return;
+        int s0, s1;
+        siteRange(inst.row_id, inst.x, (long long)inst.x + inst.macro_width, space_site_width, s0, s1);
+        row_space[inst.row_id].occupy(s0, s1);
+    }
+
+    void releaseSpace(int inst_id) {
+        const Inst& inst = db.instances[inst_id];
+        if (inst.row_id < 0) return;
+        int s0, s1;
+        siteRange(inst.row_id, inst.x, (long long)inst.x + inst.macro_width, space_site_width, s0, s1);
+        row_space[inst.row_id].release(s0, s1);
+    }
+
+    void rebuildRowSpace(int site_width) {
+        space_site_width = site_width;
+        row_space.resize(db.rows.size());
+        for (int r = 0; r < (int)db.rows.size(); ++r) {
+            const auto& row = db.rows[r];
+            row_space[r].init(row.site_count);
+            for (const auto& b : row.blockages) {
+                int s0, s1;
+                siteRange(r, b.first, b.second, site_width, s0, s1);
+                row_space[r].occupy(s0, s1);
             }
-            if (found) partial_hpwl += (max_x - min_x) + (max_y - min_y);
+            for (const auto& e : row.cells) occupySpace(e.id);
         }
-        return partial_hpwl;
+        space_synced = true;
+    }
+
+    // Site-aligned x positions in row_id where a cell of the given width fits
+    // without overlap: the nearest at or left of target_x and the nearest at
+    // or right of it. Along a row the HPWL of a single cell is convex in x, so
+    // no other free position can be better. Returns the count written to out.
+    int nearestFreeSlots(int row_id, int width, int target_x, int out[2]) const {
+        return freeSlotsNear(row_space[row_id], row_index.spanLeft(row_id), width, target_x, out);
+    }
+
+    // nearestFreeSlots over any free-site index whose site 0 is at x = left.
+    int freeSlotsNear(const RowFreeSpace& space, long long left, int width, int target_x, int out[2]) const {
+        int site_width = space_site_width;
+        int w_sites = (width + site_width - 1) / site_width;
+        int max_start = space.numSites() - w_sites;
+        if (max_start < 0) return 0;
+        int t = (int)std::llround((double)(target_x - left) / site_width);
+        t = std::min(std::max(t, 0), max_start);
+        int cnt = 0;
+        int a = space.findLastFit(t, w_sites);
+        int b = space.findFirstFit(t, w_sites);
+        if (a >= 0) out[cnt++] = (int)(left + (long long)a * site_width);
+        if (b >= 0 && b != a) out[cnt++] = (int)(left + (long long)b * site_width);
+        return cnt;
     }
 
     int findNextLegalX(int current_x, int inst_width, const std::vector<std::pair<int, int>>& blockages) {
@@ -71,116 +310,152 @@ private:
         return current_x;
     }
 
-    void rebuildRowCellIds() {
-        for (auto& row : db.rows) row.cell_ids.clear();
+    int coreSiteWidth() const {
         int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : db.core_site_width_dbu;
-        if (site_width <= 0) site_width = 200;
-        for (int i = 0; i < (int)db.instances.size(); ++i) {
-            auto& inst = db.instances[i];
-            if (inst.is_fixed) continue;
-            int best_row = -1;
-            int best_dy = std::numeric_limits<int>::max();
-            bool best_in_span = false;
+        return site_width > 0 ? site_width : 200;
+    }
+
+    // Puts inst on row_id: y and orientation follow the row, x is clamped to
+    // the row span and rounded up to the site grid. Returns true if x moved.
+    bool snapToRow(Inst& inst, int row_id, int site_width) {
+        const auto& row = db.rows[row_id];
+        inst.row_id = row_id;
+        inst.y = row.y;
+        inst.orient = row.orient;
+        long long span_left = row_index.spanLeft(row_id);
+        long long span_right = row_index.spanRight(row_id);
+        long long clamped = inst.x;
+        if (clamped < span_left) clamped = span_left;
+        if (clamped + inst.macro_width > span_right) clamped = span_right - inst.macro_width;
+        int aligned = (int)(span_left + ((clamped - span_left + site_width - 1) / site_width) * site_width);
+        if (aligned + inst.macro_width > span_right) aligned = (int)(span_right - inst.macro_width);
+        bool moved = aligned != inst.x;
+        inst.x = aligned;
+        return moved;
+    }
+
+    // Row membership follows inst.row_id and inst.x: take a cell out of its row
+    // before changing either and file it again afterwards. Filing it also
+    // moves it to its new bin.
+    void removeFromRow(int inst_id) {
+        const auto& inst = db.instances[inst_id];
+        db.rows[inst.row_id].cells.erase(inst.x, inst_id);
+    }
+
+    void addToRow(int inst_id) {
+        const auto& inst = db.instances[inst_id];
+        db.rows[inst.row_id].cells.insert(inst.x, inst_id);
+        cellMoved(inst_id);
+    }
+
+    // Every committed move of a cell ends here, which keeps the bin grid and
+    // the wide-net extremes in step with the placement.
+    void cellMoved(int inst_id) {
+        const Inst& inst = db.instances[inst_id];
+        if (grid_synced) grid.update(inst, inst_id);
+        if (wide_synced) wide_nets.move(inst_id, inst.x, inst.y);
+    }
+
+    void syncBinGrid() {
+        if (grid_synced) return;
+        grid.build(db);
+        grid_synced = true;
+    }
+
+    void syncWideNets() {
+        if (wide_synced) return;
+        wide_nets.build(nl, db.instances, wide_net_degree);
+        wide_synced = true;
+    }
+
+    // Row membership is rebuilt from scratch only when a pass left it stale
+    // (rows_synced == false). Otherwise every cell is already in its row and
+    // only needs re-snapping, and only rows where a cell moved are re-sorted.
+    void rebuildRowCellIds() {
+        int site_width = coreSiteWidth();
+
+        if (rows_synced) {
             for (int r = 0; r < (int)db.rows.size(); ++r) {
-                const auto& row = db.rows[r];
-                int rh = 0;
-                auto it = db.sites.find(row.site_name);
-                if (it != db.sites.end()) rh = it->second.height_dbu;
-                if (rh > 0 && inst.macro_height != rh) continue;
-                int dy = std::abs(row.y - inst.y);
-                long long span_left = row.x;
-                long long span_right = row.x + (long long)row.site_count * site_width;
-                bool in_span = (inst.x >= span_left) && (inst.x + inst.macro_width <= span_right);
-                if (in_span) {
-                    if (!best_in_span || dy < best_dy) { best_in_span = true; best_dy = dy; best_row = r; }
-                } else if (!best_in_span && dy < best_dy) {
-                    best_dy = dy; best_row = r;
+                auto& row = db.rows[r];
+                bool moved = false;
+                for (size_t k = 0; k < row.cells.size(); ++k) {
+                    auto& inst = db.instances[row.cells.id(k)];
+                    if (!snapToRow(inst, r, site_width)) continue;
+                    row.cells.setX(k, inst.x);
+                    cellMoved(row.cells.id(k));
+                    moved = true;
                 }
+                if (!moved) continue;
+                space_synced = false;
+                if (!row.cells.isSorted()) row.cells.sort();
             }
-            if (best_row < 0) continue;
-            auto& row = db.rows[best_row];
-            inst.row_id = best_row;
-            inst.y = row.y;
-            inst.orient = row.orient;
-            long long span_left = row.x;
-            long long span_right = row.x + (long long)row.site_count * site_width;
-            long long clamped = inst.x;
-            if (clamped < span_left) clamped = span_left;
-            if (clamped + inst.macro_width > span_right) clamped = span_right - inst.macro_width;
-            int aligned = (int)(span_left + ((clamped - span_left + site_width - 1) / site_width) * site_width);
-            if (aligned + inst.macro_width > span_right) aligned = (int)(span_right - inst.macro_width);
-            inst.x = aligned;
-            row.cell_ids.push_back(i);
-        }
-        for (auto& row : db.rows) {
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(),
-                      [&](int a, int b){ return db.instances[a].x < db.instances[b].x; });
+            if (!space_synced || space_site_width != site_width) rebuildRowSpace(site_width);
+            return;
         }
-    }
 
-    void rebuildBinGridFromDb() {
-        clearBinGrid();
-        populateBinGrid();
+        for (auto& row : db.rows) row.cells.clear();
+        for (int i = 0; i < (int)db.instances.size(); ++i) {
+            auto& inst = db.instances[i];
+            if (inst.is_fixed) continue;
+            int best_row = row_index.findRow(inst.x, inst.y, inst.macro_width, inst.macro_height);
+            if (best_row < 0) continue;
+            snapToRow(inst, best_row, site_width);
+            db.rows[best_row].cells.push_back(inst.x, i);
+            cellMoved(i);
+        }
+        for (auto& row : db.rows) row.cells.sort();
+        rows_synced = true;
+        rebuildRowSpace(site_width);
     }
 
 public:
-    Placer(DesignDB& database) : db(database) {
-        for (int net_id = 0; net_id < (int)db.nets.size(); ++net_id) {
-            const auto& net = db.nets[net_id];
-            for (const auto& pin : net.pins) {
-                if (!pin.is_port) inst_to_nets_map[pin.inst_id].insert(net_id);
-            }
+    // db.netlist must already be built (buildNetlistView) for the current
+    // instance and net order.
+    Placer(DesignDB& database) : db(database), nl(database.netlist) {
+        if (nl.numNets() != (int)db.nets.size() || nl.cell_net_start.size() != db.instances.size() + 1) {
+            std::cerr << "[Placer] Error: netlist view is missing or stale; run buildNetlistView first" << std::endl;
+            exit(1);
         }
+        affected.init(nl.numNets());
+        net_table.build(nl);
+        resizeWindowScratch(1);
+        row_index.build(db, coreSiteWidth());
     }
 
+    long long movesEvaluated() const { return counters.moves_evaluated; }
+    const PassCounters& passCounters() const { return counters; }
+
     void initializeBinGrid(int nx, int ny) {
         grid.init(db.die_x_max, db.die_y_max, nx, ny);
-    }
-
-    void clearBinGrid() {
-        grid.clear();
-    }
-
-    void populateBinGrid() {
-        for (int i = 0; i < (int)db.instances.size(); ++i) {
-            if (!db.instances[i].is_fixed) grid.addInstance(db.instances[i], i);
-        }
+        grid_synced = false;
     }
 
     void runNbbSwap(int iterations) {
         rebuildRowCellIds();
-        rebuildBinGridFromDb();
+        syncBinGrid();
+        syncWideNets();
 
         std::vector<int> movable_inst_ids;
         for (int i = 0; i < (int)db.instances.size(); ++i) if (!db.instances[i].is_fixed) movable_inst_ids.push_back(i);
         if (movable_inst_ids.size() < 2) return;
 
         for (int i = 0; i < iterations; ++i) {
+            if ((i & 1023) == 0 && pastDeadline()) break;
             int inst_id_A = movable_inst_ids[rand() % movable_inst_ids.size()];
             auto& instA = db.instances[inst_id_A];
             if (instA.row_id < 0) continue;
 
-            std::set<int> nets_A;
-            if (inst_to_nets_map.count(inst_id_A)) nets_A = inst_to_nets_map.at(inst_id_A);
+            Span<uint32_t> nets_A = nl.cellNets(inst_id_A);
             if (nets_A.empty()) continue;
             long long min_x=1e18, max_x=-1e18, min_y=1e18, max_y=-1e18;
             int pins_in_bbox = 0;
-            for (int net_id : nets_A) {
-                for (const auto& pin : db.nets[net_id].pins) {
-                    if (pin.is_port) {
-                        auto it = db.io_pins.find(pin.port_name);
-                        if (it != db.io_pins.end()) {
-                            min_x = std::min(min_x, (long long)it->second.x); max_x = std::max(max_x, (long long)it->second.x);
-                            min_y = std::min(min_y, (long long)it->second.y); max_y = std::max(max_y, (long long)it->second.y);
-                            pins_in_bbox++;
-                        }
-                    } else if (pin.inst_id != inst_id_A && pin.inst_id >= 0) {
-                        const auto& inst = db.instances[pin.inst_id];
-                        min_x = std::min(min_x, (long long)inst.x); max_x = std::max(max_x, (long long)inst.x);
-                        min_y = std::min(min_y, (long long)inst.y); max_y = std::max(max_y, (long long)inst.y);
-                        pins_in_bbox++;
-                    }
-                }
+            for (uint32_t net_id : nets_A) {
+                int x1, x2, y1, y2;
+                counters.hpwl_evals++;
+                if (!placedBoxWithout(net_id, inst_id_A, x1, x2, y1, y2, counters)) continue;
+                min_x = std::min<long long>(min_x, x1); max_x = std::max<long long>(max_x, x2);
+                min_y = std::min<long long>(min_y, y1); max_y = std::max<long long>(max_y, y2);
+                pins_in_bbox++;
             }
             if (pins_in_bbox < 1) continue;
 
@@ -188,8 +463,7 @@ public:
             int ideal_y = (int)((min_y + max_y) / 2);
 
             auto bin_indices = grid.getBinIndex(ideal_x, ideal_y);
-            if (grid.bins[bin_indices.first][bin_indices.second].cells_by_width.count(instA.macro_width) == 0) continue;
-            auto& candidates = grid.bins[bin_indices.first][bin_indices.second].cells_by_width.at(instA.macro_width);
+            Span<int> candidates = grid.cellsOfWidth(bin_indices.first, bin_indices.second, instA.macro_width);
             if (candidates.empty()) continue;
 
             int inst_id_B = candidates[rand() % candidates.size()];
@@ -197,564 +471,1287 @@ public:
             if (inst_id_A == inst_id_B) continue;
             if (instB.row_id < 0 || instA.macro_height != instB.macro_height) continue;
 
-            std::set<int> affected_net_ids;
-            if (inst_to_nets_map.count(inst_id_A)) affected_net_ids.insert(inst_to_nets_map.at(inst_id_A).begin(), inst_to_nets_map.at(inst_id_A).end());
-            if (inst_to_nets_map.count(inst_id_B)) affected_net_ids.insert(inst_to_nets_map.at(inst_id_B).begin(), inst_to_nets_map.at(inst_id_B).end());
-            if (affected_net_ids.empty()) continue;
+            affected.clear();
+            affected.add(nets_A);
+            affected.add(nl.cellNets(inst_id_B));
+            if (affected.empty()) continue;
 
-            long long hpwl_old = calculatePartialHPWL(affected_net_ids);
+            counters.moves_evaluated++;
+            if (movedDelta(affected.span(), inst_id_A, instB.x, instB.y, inst_id_B, instA.x, instA.y, counters) >= 0)
+                continue;
 
-            std::string old_orient_A = instA.orient;
-            std::string old_orient_B = instB.orient;
             std::swap(instA.x, instB.x);
             std::swap(instA.y, instB.y);
             std::swap(instA.row_id, instB.row_id);
             instA.orient = db.rows[instA.row_id].orient;
             instB.orient = db.rows[instB.row_id].orient;
+            counters.moves_accepted++;
+            cellMoved(inst_id_A);
+            cellMoved(inst_id_B);
+        }
+        // Swaps above change row_id without touching row.cells.
+        rows_synced = false;
+        space_synced = false;
+    }
 
-            long long hpwl_new = calculatePartialHPWL(affected_net_ids);
-
-            if (hpwl_new >= hpwl_old) {
-                std::swap(instA.x, instB.x);
-                std::swap(instA.y, instB.y);
-                std::swap(instA.row_id, instB.row_id);
-                instA.orient = old_orient_A;
-                instB.orient = old_orient_B;
+    // Independent-set matching: cells of one width and height, taken from a
+    // window of bins, are reassigned among their own slots by a min-cost
+    // matching. No two cells picked in the same round share a net, so the
+    // HPWL of an assignment is exactly the sum of per-cell costs, and all
+    // batches of a round can be costed and solved concurrently from the same
+    // placement. Slots are permuted among equal widths, so row free space is
+    // unchanged. window_bins is the side of the bin window in BinGrid bins.
+    void runIndependentSetMatching(int window_bins, int batch_size) {
+        rebuildRowCellIds();
+        syncBinGrid();
+        syncWideNets();
+        if (window_bins < 1) window_bins = 1;
+        if (batch_size < 2) return;
+
+        ism_done.assign(db.instances.size(), 0);
+        ism_net_mark.assign(nl.numNets(), 0);
+        if ((int)ism_scratch.size() < pool.size()) ism_scratch.resize(pool.size());
+
+        const int kMaxRounds = 8;
+        for (int round = 1; round <= kMaxRounds; ++round) {
+            if (pastDeadline()) break;
+            int num_batches = 0;
+            for (int by = 0; by < grid.num_bins_y; by += window_bins) {
+                for (int bx = 0; bx < grid.num_bins_x; bx += window_bins) {
+                    ism_pool.clear();
+                    for (int i = bx; i < std::min(bx + window_bins, grid.num_bins_x); ++i) {
+                        for (int j = by; j < std::min(by + window_bins, grid.num_bins_y); ++j) {
+                            for (int id : grid.cells(i, j)) {
+                                const Inst& inst = db.instances[id];
+                                if (ism_done[id] || inst.row_id < 0 || nl.cellNets(id).empty()) continue;
+                                long long key = ((long long)inst.macro_width << 32) | (unsigned)inst.macro_height;
+                                ism_pool.push_back(std::make_pair(key, id));
+                            }
+                        }
+                    }
+                    std::sort(ism_pool.begin(), ism_pool.end());
+                    for (size_t g = 0; g < ism_pool.size(); ) {
+                        size_t g_end = g;
+                        while (g_end < ism_pool.size() && ism_pool[g_end].first == ism_pool[g].first) ++g_end;
+                        IsmBatch* batch = nullptr;
+                        for (size_t k = g; k < g_end; ++k) {
+                            int id = ism_pool[k].second;
+                            bool free = true;
+                            for (uint32_t net : nl.cellNets(id)) if (ism_net_mark[net] == round) { free = false; break; }
+                            if (!free) continue;
+                            for (uint32_t net : nl.cellNets(id)) ism_net_mark[net] = round;
+                            if (!batch) {
+                                if ((int)ism_batches.size() <= num_batches) ism_batches.emplace_back();
+                                batch = &ism_batches[num_batches];
+                                batch->cells.clear();
+                            }
+                            batch->cells.push_back(id);
+                            if ((int)batch->cells.size() == batch_size) {
+                                for (int c : batch->cells) ism_done[c] = 1;
+                                ++num_batches;
+                                batch = nullptr;
+                            }
+                        }
+                        if (batch && batch->cells.size() >= 2) {
+                            for (int c : batch->cells) ism_done[c] = 1;
+                            ++num_batches;
+                        }
+                        g = g_end;
+                    }
+                }
             }
+            if (num_batches == 0) break;
+
+            pool.parallelFor(num_batches, [&](int b, int worker){
+                solveIsmBatch(ism_batches[b], ism_scratch[worker]);
+            });
+            for (int b = 0; b < num_batches; ++b) commitIsmBatch(ism_batches[b]);
+        }
+        for (auto& scr : ism_scratch) {
+            counters += scr.counters;
+            scr.counters = PassCounters();
         }
     }
 
-    void runSlidingWindow(int window_size) {
-        rebuildRowCellIds();
+private:
+    struct IsmBatch {
+        std::vector<int> cells;
+        std::vector<long long> cost;
+        std::vector<int> slot_of;
+        long long gain = 0;
+    };
+    struct IsmScratch {
+        HungarianSolver solver;
+        std::vector<int> box;
+        PassCounters counters;
+    };
+    std::vector<IsmBatch> ism_batches;
+    std::vector<IsmScratch> ism_scratch;
+    std::vector<std::pair<long long, int>> ism_pool;
+    std::vector<char> ism_done;
+    std::vector<int> ism_net_mark;
+    struct Slot { int x, y, row_id; };
+    std::vector<Slot> ism_slots;
+
+    // cost[i][j] is the HPWL of cell i's nets with cell i on cell j's slot.
+    // Each net's box over its other pins is computed once per cell, so an
+    // entry costs O(degree of the cell).
+    void solveIsmBatch(IsmBatch& batch, IsmScratch& scr) {
+        int n = batch.cells.size();
+        batch.cost.assign((size_t)n * n, 0);
+        const PlacedPos placed{this};
+        for (int i = 0; i < n; ++i) {
+            int id = batch.cells[i];
+            collectNetBoxes(id, nl.cellNets(id), placed, scr.box, scr.counters);
+            for (int j = 0; j < n; ++j) {
+                const Inst& slot = db.instances[batch.cells[j]];
+                batch.cost[(size_t)i * n + j] = boxedHPWL(scr.box, slot.x, slot.y);
+            }
+        }
+        scr.counters.moves_evaluated += (long long)n * n;
 
-        int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : db.core_site_width_dbu;
-        if (site_width == 0) site_width = 200;
+        long long current = 0;
+        for (int i = 0; i < n; ++i) current += batch.cost[(size_t)i * n + i];
+        long long best = scr.solver.solve(batch.cost, n, batch.slot_of);
+        batch.gain = current - best;
+    }
 
-        for (auto &row : db.rows) {
-            if ((int)row.cell_ids.size() < 2) continue;
-            const auto& blockages = row.blockages;
-            for (int i = 0; i <= (int)row.cell_ids.size() - window_size; ++i) {
-                std::vector<int> window_inst_ids;
-                std::vector<int> window_indices;
-                for (int j = 0; j < window_size; ++j) {
-                    window_inst_ids.push_back(row.cell_ids[i+j]);
-                    window_indices.push_back(j);
-                }
+    void commitIsmBatch(const IsmBatch& batch) {
+        if (batch.gain <= 0) return;
+        int n = batch.cells.size();
+        ism_slots.clear();
+        for (int id : batch.cells) {
+            const Inst& inst = db.instances[id];
+            ism_slots.push_back(Slot{inst.x, inst.y, inst.row_id});
+        }
+        for (int i = 0; i < n; ++i) if (batch.slot_of[i] != i) removeFromRow(batch.cells[i]);
+        for (int i = 0; i < n; ++i) {
+            int j = batch.slot_of[i];
+            if (j == i) continue;
+            counters.moves_accepted++;
+            Inst& inst = db.instances[batch.cells[i]];
+            inst.x = ism_slots[j].x;
+            inst.y = ism_slots[j].y;
+            inst.row_id = ism_slots[j].row_id;
+            inst.orient = db.rows[inst.row_id].orient;
+            addToRow(batch.cells[i]);
+        }
+    }
 
-                std::set<int> affected_net_ids;
-                for (int inst_id : window_inst_ids) {
-                    if (inst_to_nets_map.count(inst_id)) {
-                        affected_net_ids.insert(inst_to_nets_map.at(inst_id).begin(), inst_to_nets_map.at(inst_id).end());
-                    }
+private:
+    // Sliding-window model. All window cells sit on one row, so a reordering
+    // only changes the x extent of their nets. Each local net keeps the x box
+    // of its pins outside the window; during the search the box also covers
+    // the window cells placed so far, left to right.
+    struct WindowNet {
+        int ext_lo, ext_hi;
+        int lo, hi;
+        int unplaced;
+    };
+    struct WindowUndo { int net, lo, hi; };
+    struct WindowSearch {
+        std::vector<int> ids, width;
+        std::vector<WindowNet> nets;
+        std::vector<std::vector<int>> cell_nets;
+        std::vector<int> order, best_order;
+        std::vector<char> used;
+        std::vector<WindowUndo> undo;
+        std::vector<int> net_mask, set_width;
+        std::vector<long long> rest_cost;
+        long long best_cost = 0;
+        int end_x = 0;
+        const std::vector<std::pair<int, int>>* blockages = nullptr;
+        NetScratch seen;
+        PassCounters counters;
+    };
+    // One per pool thread; the thread index selects the scratch.
+    std::vector<WindowSearch> win_scratch;
+    ThreadPool pool;
+    // Latest wave of a task that reads a net's pins, and of one that moves them.
+    std::vector<int> net_wave, net_write_wave;
+    int window_pass = 0;
+    DeadlineClock::time_point deadline;
+    bool has_deadline = false;
+    HpwlEvaluator hpwl_eval;
+    AbacusLegalizer legalizer;
+
+    // Builds the local nets of win.ids and returns their x cost at the
+    // current positions. Nets that task `task` shields over [x0, x1] are left
+    // out: their extent is the same for every ordering, and their other pins
+    // may belong to tasks running concurrently.
+    long long buildWindowModel(WindowSearch& win, int task, int x0, int x1) {
+        int n = win.ids.size();
+        win.width.resize(n);
+        win.cell_nets.resize(n);
+        win.order.assign(n, 0);
+        win.used.assign(n, 0);
+        for (int k = 0; k < n; ++k) {
+            win.width[k] = db.instances[win.ids[k]].macro_width;
+            win.cell_nets[k].clear();
+        }
+        win.seen.clear();
+        for (int id : win.ids) win.seen.add(nl.cellNets(id));
+
+        win.nets.clear();
+        long long cost = 0;
+        for (uint32_t net_id : win.seen.span()) {
+            if (net_guards[net_id].shields(task, x0, x1)) continue;
+            int j = win.nets.size();
+            WindowNet net;
+            net.ext_lo = std::numeric_limits<int>::max();
+            net.ext_hi = std::numeric_limits<int>::min();
+            net.unplaced = 0;
+            int cur_lo = net.ext_lo, cur_hi = net.ext_hi;
+            Span<int32_t> pins = nl.netPins(net_id);
+            win.counters.hpwl_evals++;
+            win.counters.pins_scanned += pins.size();
+            for (int32_t ref : pins) {
+                int x = pinX(ref);
+                cur_lo = std::min(cur_lo, x);
+                cur_hi = std::max(cur_hi, x);
+                int k = 0;
+                while (k < n && win.ids[k] != ref) ++k;
+                if (k == n) {
+                    net.ext_lo = std::min(net.ext_lo, x);
+                    net.ext_hi = std::max(net.ext_hi, x);
+                } else if (win.cell_nets[k].empty() || win.cell_nets[k].back() != j) {
+                    win.cell_nets[k].push_back(j);
+                    net.unplaced++;
                 }
-                if (affected_net_ids.empty()) continue;
+            }
+            if (cur_lo <= cur_hi) cost += cur_hi - cur_lo;
+            net.lo = net.ext_lo;
+            net.hi = net.ext_hi;
+            win.nets.push_back(net);
+        }
+        return cost;
+    }
 
-                long long hpwl_old = calculatePartialHPWL(affected_net_ids);
-                long long best_hpwl = hpwl_old;
-                std::vector<int> best_permutation = window_indices;
-                std::vector<int> old_x;
-                for (int id : window_inst_ids) old_x.push_back(db.instances[id].x);
+    // Lower bound on the x cost of every completion of the current prefix:
+    // cells still to place start at or right of cur_x, so an open net can
+    // only grow rightwards from there.
+    long long windowBound(const WindowSearch& win, int cur_x) const {
+        long long cost = 0;
+        for (const auto& net : win.nets) {
+            if (net.lo > net.hi) continue;
+            cost += (long long)(net.unplaced ? std::max(net.hi, cur_x) : net.hi) - net.lo;
+        }
+        return cost;
+    }
 
-                const int window_start_x = old_x[0];
-                int window_end_x = (i + window_size < (int)row.cell_ids.size()) ?
-                    db.instances[row.cell_ids[i + window_size]].x :
-                    (row.x + (row.site_count * site_width));
+    // Depth-first branch and bound over orderings, in the same lexicographic
+    // order as next_permutation, keeping the first ordering that strictly
+    // beats win.best_cost.
+    void windowSearch(WindowSearch& win, int depth, int cur_x, int remaining_width) {
+        int n = win.ids.size();
+        if (depth == n) {
+            win.counters.moves_evaluated++;
+            long long cost = windowBound(win, cur_x);
+            if (cost < win.best_cost) {
+                win.best_cost = cost;
+                win.best_order = win.order;
+            }
+            return;
+        }
+        if (cur_x + remaining_width > win.end_x) return;
+        if (windowBound(win, cur_x) >= win.best_cost) return;
+
+        for (int k = 0; k < n; ++k) {
+            if (win.used[k]) continue;
+            int x = findNextLegalX(cur_x, win.width[k], *win.blockages);
+            if (x + win.width[k] > win.end_x) continue;
+            size_t mark = win.undo.size();
+            for (int j : win.cell_nets[k]) {
+                WindowNet& net = win.nets[j];
+                win.undo.push_back(WindowUndo{j, net.lo, net.hi});
+                net.lo = std::min(net.lo, x);
+                net.hi = std::max(net.hi, x);
+                net.unplaced--;
+            }
+            win.used[k] = 1;
+            win.order[depth] = k;
+            windowSearch(win, depth + 1, x + win.width[k], remaining_width - win.width[k]);
+            win.used[k] = 0;
+            while (win.undo.size() > mark) {
+                const WindowUndo& u = win.undo.back();
+                WindowNet& net = win.nets[u.net];
+                net.lo = u.lo;
+                net.hi = u.hi;
+                net.unplaced++;
+                win.undo.pop_back();
+            }
+        }
+    }
 
-                std::vector<int> current_permutation = window_indices;
-                bool at_least_one_legal = false;
+    // Cost of placing window cell k at x after the cells in `placed`. With
+    // positions fixed by the placed set, a net's x extent is set by the cell
+    // that opens it (first placed) and the one that closes it (last placed),
+    // so the window cost is a sum of these per-placement terms.
+    long long windowStepCost(const WindowSearch& win, int placed, int k, int x) const {
+        long long cost = 0;
+        int after = placed | (1 << k);
+        for (int j : win.cell_nets[k]) {
+            const WindowNet& net = win.nets[j];
+            int mask = win.net_mask[j];
+            if (!(placed & mask)) cost -= std::min(net.ext_lo, x);
+            if ((after & mask) == mask) cost += std::max(net.ext_hi, x);
+        }
+        return cost;
+    }
 
-                do {
-                    int current_x = window_start_x;
-                    bool is_legal = true;
+    // Exact optimum by DP over the set of placed cells, for windows that no
+    // blockage meets: there the next x is start_x plus the placed width
+    // whatever the order. rest_cost[S] is the cheapest completion from S; the
+    // walk from the empty set takes the lowest-index cell on an optimal path,
+    // giving the same ordering windowSearch() would.
+    void windowSubsetDP(WindowSearch& win, int start_x) {
+        int n = win.ids.size();
+        int full = (1 << n) - 1;
+        win.net_mask.assign(win.nets.size(), 0);
+        for (int k = 0; k < n; ++k)
+            for (int j : win.cell_nets[k]) win.net_mask[j] |= 1 << k;
+        win.set_width.assign(full + 1, 0);
+        for (int set = 1; set <= full; ++set)
+            win.set_width[set] = win.set_width[set & (set - 1)] + win.width[__builtin_ctz(set)];
+
+        win.rest_cost.assign(full + 1, std::numeric_limits<long long>::max());
+        win.rest_cost[full] = 0;
+        for (int set = full - 1; set >= 0; --set) {
+            int x = start_x + win.set_width[set];
+            for (int k = 0; k < n; ++k) {
+                if (set & (1 << k)) continue;
+                win.counters.moves_evaluated++;
+                long long cost = windowStepCost(win, set, k, x) + win.rest_cost[set | (1 << k)];
+                win.rest_cost[set] = std::min(win.rest_cost[set], cost);
+            }
+        }
+        if (win.rest_cost[0] >= win.best_cost) return;
+
+        win.best_cost = win.rest_cost[0];
+        win.best_order.clear();
+        for (int set = 0; set != full; ) {
+            int x = start_x + win.set_width[set];
+            for (int k = 0; k < n; ++k) {
+                if (set & (1 << k)) continue;
+                if (windowStepCost(win, set, k, x) + win.rest_cost[set | (1 << k)] != win.rest_cost[set]) continue;
+                win.best_order.push_back(k);
+                set |= 1 << k;
+                break;
+            }
+        }
+    }
 
-                    for (int k = 0; k < (int)window_inst_ids.size(); ++k) {
-                        db.instances[window_inst_ids[k]].x = old_x[k];
-                    }
+    bool blockageWithin(const std::vector<std::pair<int, int>>& blockages, int x0, int x1) const {
+        for (const auto& b : blockages)
+            if (b.first < x1 && b.second > x0) return true;
+        return false;
+    }
 
-                    for (int p_idx : current_permutation) {
-                        int inst_id = window_inst_ids[p_idx];
-                        int inst_width = db.instances[inst_id].macro_width;
+    // A task covers row cells [a, b); its cells stay within [x0, end_x] for
+    // the whole pass, x0 being the x of cell a when the pass starts. color
+    // fixes the serial order (see runSlidingWindow), wave the parallel step
+    // it runs in.
+    struct WindowTask { int row, a, b, x0, end_x, color, wave; };
+
+    // Slides windows over the cells of tasks[ti] without crossing cell b; the
+    // last window is bounded by end_x.
+    void slideSegment(WindowSearch& win, const std::vector<WindowTask>& tasks, int ti, int window_size) {
+        const WindowTask& t = tasks[ti];
+        Row& row = db.rows[t.row];
+        const auto& blockages = row.blockages;
+        const int a = t.a, b = t.b, end_x = t.end_x;
+        for (int i = a; i + window_size <= b; ++i) {
+            win.ids.clear();
+            for (int j = 0; j < window_size; ++j) win.ids.push_back(row.cells.id(i + j));
+
+            long long cost_old = buildWindowModel(win, ti, t.x0, end_x);
+            if (win.nets.empty()) continue;
+
+            const int window_start_x = row.cells.x(i);
+            win.end_x = (i + window_size < b) ? row.cells.x(i + window_size) : end_x;
+            win.blockages = &blockages;
+            win.best_cost = cost_old;
+            win.best_order.clear();
+            int total_width = 0;
+            for (int w : win.width) total_width += w;
+            if (window_start_x + total_width > win.end_x) continue;
+            if (window_size > 3 && window_size <= 12 && !blockageWithin(blockages, window_start_x, win.end_x))
+                windowSubsetDP(win, window_start_x);
+            else
+                windowSearch(win, 0, window_start_x, total_width);
+
+            if (win.best_order.empty()) continue;
+            win.counters.moves_accepted++;
+            int current_x = window_start_x;
+            for (int k = 0; k < window_size; ++k) {
+                int inst_id = win.ids[win.best_order[k]];
+                int inst_width = db.instances[inst_id].macro_width;
+                current_x = findNextLegalX(current_x, inst_width, blockages);
+                db.instances[inst_id].x = current_x;
+                row.cells.set(i + k, current_x, inst_id);
+                current_x += inst_width;
+            }
+        }
+    }
 
-                        auto it_block = std::lower_bound(blockages.begin(), blockages.end(), std::make_pair(current_x, 0));
-                        if (it_block != blockages.end()) {
-                            if (current_x < it_block->second && (current_x + inst_width) > it_block->first) current_x = it_block->second;
-                        }
-                        if (it_block != blockages.begin()) {
-                            auto it_prev = std::prev(it_block);
-                            if (current_x < it_prev->second && (current_x + inst_width) > it_prev->first) current_x = it_prev->second;
-                        }
+    // Pins of a net that bound it from the left (smallest guaranteed-max x)
+    // and from the right (largest guaranteed-min x), two per side from
+    // different tasks. A pin outside every task keeps its x; a pin in a task
+    // stays within the task's x range.
+    struct NetGuard {
+        int lo1, lo1_task, lo2;
+        int hi1, hi1_task, hi2;
+
+        void reset() {
+            lo1 = lo2 = std::numeric_limits<int>::max();
+            hi1 = hi2 = std::numeric_limits<int>::min();
+            lo1_task = hi1_task = -2;
+        }
 
-                        db.instances[inst_id].x = current_x;
-                        if ((current_x + inst_width) > window_end_x) { is_legal = false; break; }
-                        current_x += inst_width;
-                    }
-                    if (!is_legal) continue;
-                    at_least_one_legal = true;
+        void add(int max_x, int min_x, int task) {
+            if (task == lo1_task) lo1 = std::min(lo1, max_x);
+            else if (max_x < lo1) { lo2 = lo1; lo1 = max_x; lo1_task = task; }
+            else lo2 = std::min(lo2, max_x);
+            if (task == hi1_task) hi1 = std::max(hi1, min_x);
+            else if (min_x > hi1) { hi2 = hi1; hi1 = min_x; hi1_task = task; }
+            else hi2 = std::max(hi2, min_x);
+        }
 
-                    long long hpwl_new = calculatePartialHPWL(affected_net_ids);
-                    if (hpwl_new < best_hpwl) {
-                        best_hpwl = hpwl_new;
-                        best_permutation = current_permutation;
-                    }
-                } while (std::next_permutation(current_permutation.begin(), current_permutation.end()));
-
-                for (int k = 0; k < (int)window_inst_ids.size(); ++k) db.instances[window_inst_ids[k]].x = old_x[k];
-
-                if (best_hpwl < hpwl_old && at_least_one_legal) {
-                    int current_x = window_start_x;
-                    for (int p_idx : best_permutation) {
-                        int inst_id = window_inst_ids[p_idx];
-                        int inst_width = db.instances[inst_id].macro_width;
-                        auto it_block = std::lower_bound(blockages.begin(), blockages.end(), std::make_pair(current_x, 0));
-                        if (it_block != blockages.end()) {
-                            if (current_x < it_block->second && (current_x + inst_width) > it_block->first) current_x = it_block->second;
-                        }
-                        if (it_block != blockages.begin()) {
-                            auto it_prev = std::prev(it_block);
-                            if (current_x < it_prev->second && (current_x + inst_width) > it_prev->first) current_x = it_prev->second;
-                        }
-                        db.instances[inst_id].x = current_x;
-                        current_x += inst_width;
-                    }
-                    std::sort(row.cell_ids.begin() + i, row.cell_ids.begin() + i + window_size,
-                              [&](int a, int b){ return db.instances[a].x < db.instances[b].x; });
+        // True if pins outside the task always bracket [x0, x1]: the task can
+        // then neither change the net's extent nor see it change.
+        bool shields(int task, int x0, int x1) const {
+            int left = (lo1_task != task) ? lo1 : lo2;
+            int right = (hi1_task != task) ? hi1 : hi2;
+            return left <= x0 && right >= x1;
+        }
+    };
+    std::vector<NetGuard> net_guards;
+    std::vector<int> cell_task;
+
+    void buildNetGuards(const std::vector<WindowTask>& tasks) {
+        cell_task.assign(db.instances.size(), -1);
+        for (int t = 0; t < (int)tasks.size(); ++t) {
+            const Row& row = db.rows[tasks[t].row];
+            for (int k = tasks[t].a; k < tasks[t].b; ++k) cell_task[row.cells.id(k)] = t;
+        }
+        net_guards.resize(nl.numNets());
+        for (int net = 0; net < nl.numNets(); ++net) {
+            NetGuard& g = net_guards[net];
+            g.reset();
+            for (int32_t ref : nl.netPins(net)) {
+                int t = ref >= 0 ? cell_task[ref] : -1;
+                if (t < 0) {
+                    int x = pinX(ref);
+                    g.add(x, x, -1);
+                } else {
+                    const WindowTask& task = tasks[t];
+                    g.add(task.end_x, task.x0, t);
+                }
+            }
+        }
+    }
+
+    void resizeWindowScratch(int n) {
+        win_scratch.resize(n);
+        for (auto& win : win_scratch) win.seen.init(nl.numNets());
+    }
+
+public:
+    void setNumThreads(int num_threads) {
+        num_threads = std::max(num_threads, 1);
+        pool.resize(num_threads);
+        resizeWindowScratch(num_threads);
+    }
+
+    int numThreads() const { return pool.size(); }
+
+    // Nets of at least this many pins are costed from their kept extremes;
+    // 0 turns that off.
+    void setWideNetDegree(int degree) {
+        wide_net_degree = degree > 0 ? degree : std::numeric_limits<int>::max();
+        wide_synced = false;
+    }
+
+    // Tile grid side for runTiledInsertOrSwap: about four tiles per thread,
+    // so uneven tiles still balance, and never fewer than 4x4.
+    static int tilesPerSide(int threads) { return std::max(4, (int)std::ceil(std::sqrt(4.0 * threads))); }
+
+    // Total HPWL of the current placement, summed on the placer's threads.
+    long long totalHPWL() { return hpwl_eval.total(db, &pool); }
+
+    // Improvement passes poll the deadline at checkpoints (between cells,
+    // window segments or matching rounds) and return early once it has
+    // passed. Every checkpoint sits between committed moves, so a preempted
+    // pass leaves the placement as consistent as a finished one.
+    // runRowLegalize ignores it.
+    void setDeadline(DeadlineClock::time_point t) { deadline = t; has_deadline = true; }
+    void clearDeadline() { has_deadline = false; }
+    bool pastDeadline() const { return has_deadline && DeadlineClock::now() >= deadline; }
+
+    // Rows are cut into segments of kWindowSegment cells and windows stay
+    // inside their segment, so every task's cells and nets are known before
+    // the pass starts. A window never moves cells left of its first cell,
+    // which makes the x of the next segment's first cell a safe right bound.
+    // The serial order takes the four (row parity, segment parity) classes
+    // one after another, row-major within each, and every task gets the wave
+    // one past the latest wave of any task it conflicts with on a net. Nets
+    // that a task cannot affect (NetGuard::shields) are left out of its window
+    // model, so the task only moves their pins; on its other nets it also
+    // reads the pins. A task waits for every earlier reader of a net whose
+    // pins it moves, and for every earlier task moving pins of a net it reads.
+    // Tasks within a wave thus neither read nor write each other's cells and
+    // run concurrently, and the result equals the serial pass for any thread
+    // count. Segment borders shift by half a segment on every other
+    // call.
+    void runSlidingWindow(int window_size) {
+        rebuildRowCellIds();
+
+        int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : db.core_site_width_dbu;
+        if (site_width == 0) site_width = 200;
+
+        const int kWindowSegment = 64;
+        std::vector<WindowTask> tasks;
+        net_wave.assign(nl.numNets(), -1);
+        net_write_wave.assign(nl.numNets(), -1);
+        int num_waves = 0;
+        int offset = (window_pass++ & 1) ? kWindowSegment / 2 : 0;
+        for (int r = 0; r < (int)db.rows.size(); ++r) {
+            const Row& row = db.rows[r];
+            int n = row.cells.size();
+            int row_end = row.x + row.site_count * site_width;
+            for (int a = 0, seg = 0; a < n; ++seg) {
+                int b = std::min(n, a == 0 && offset > 0 ? offset : a + kWindowSegment);
+                if (b - a >= window_size)
+                    tasks.push_back(WindowTask{r, a, b, row.cells.x(a), b < n ? row.cells.x(b) : row_end, (r & 1) * 2 + (seg & 1), 0});
+                a = b;
+            }
+        }
+        std::stable_sort(tasks.begin(), tasks.end(), [](const WindowTask& x, const WindowTask& y){ return x.color < y.color; });
+        buildNetGuards(tasks);
+        for (int ti = 0; ti < (int)tasks.size(); ++ti) {
+            WindowTask& t = tasks[ti];
+            const Row& row = db.rows[t.row];
+            for (int k = t.a; k < t.b; ++k) {
+                for (uint32_t net : nl.cellNets(row.cells.id(k))) {
+                    int after = net_wave[net];
+                    if (!net_guards[net].shields(ti, t.x0, t.end_x)) after = std::max(after, net_write_wave[net]);
+                    t.wave = std::max(t.wave, after + 1);
                 }
             }
+            for (int k = t.a; k < t.b; ++k) {
+                for (uint32_t net : nl.cellNets(row.cells.id(k))) {
+                    net_write_wave[net] = std::max(net_write_wave[net], t.wave);
+                    if (!net_guards[net].shields(ti, t.x0, t.end_x)) net_wave[net] = std::max(net_wave[net], t.wave);
+                }
+            }
+            num_waves = std::max(num_waves, t.wave + 1);
+        }
+
+        std::vector<int> wave_start(num_waves + 1, 0), by_wave(tasks.size());
+        for (const auto& t : tasks) wave_start[t.wave + 1]++;
+        for (int w = 0; w < num_waves; ++w) wave_start[w + 1] += wave_start[w];
+        std::vector<int> fill(wave_start.begin(), wave_start.end() - 1);
+        for (int t = 0; t < (int)tasks.size(); ++t) by_wave[fill[tasks[t].wave]++] = t;
+
+        if ((int)win_scratch.size() < pool.size()) resizeWindowScratch(pool.size());
+        for (int w = 0; w < num_waves; ++w) {
+            int first = wave_start[w];
+            if (pastDeadline()) break;
+            pool.parallelFor(wave_start[w + 1] - first, [&](int k, int worker){
+                // Segments are independent, so skipping the rest is safe.
+                if (pastDeadline()) return;
+                slideSegment(win_scratch[worker], tasks, by_wave[first + k], window_size);
+            });
+        }
+        for (auto& win : win_scratch) {
+            counters += win.counters;
+            win.counters = PassCounters();
         }
+        // Windows run concurrently, so their cells are refiled afterwards.
+        for (const auto& t : tasks) {
+            for (int k = t.a; k < t.b; ++k) cellMoved(db.rows[t.row].cells.id(k));
+        }
+        // Segments of one row share its free-space tree, so it is rebuilt
+        // once on the next pass instead of being updated per commit.
+        space_synced = false;
     }
 
+    // Cells in decreasing degree order; each moves to the best free slot or
+    // same-size cell near its optimal region (see runSpeculative).
     void runGlobalInsertOrSwap() {
         rebuildRowCellIds();
+        syncBinGrid();
+        syncWideNets();
+        if (db.rows.empty()) return;
+        runSpeculative(cellsByDegree((int)db.instances.size()), [&](SpecScratch& ss, int id) {
+            return bestInsertOrSwap(ss, id);
+        });
+    }
 
-        std::vector<std::pair<int,int>> movable_candidates;
+private:
+    // A move picked by speculative evaluation. delta < 0 marks an improving
+    // move; partner >= 0 makes it a swap, otherwise the cell goes to (row, x).
+    struct SpecMove {
+        int cell = -1;
+        int partner = -1;
+        int row = -1, x = 0;
+        long long delta = 0;
+    };
+    struct SpecScratch {
+        NetScratch affected;
+        std::vector<int> box, xs, ys;
+        std::vector<std::pair<int,int>> rows;
+        PassCounters counters;
+    };
+    std::vector<SpecScratch> spec_scratch;      // per worker
+    std::vector<SpecMove> spec_moves;
+    // Batch number of the last commit that changed each net, row and cell.
+    std::vector<int> net_stamp, row_stamp, cell_stamp;
+    int spec_batch = 0;
+
+    // Movable cells, highest degree first, at most max_cells of them.
+    std::vector<int> cellsByDegree(int max_cells) const {
+        std::vector<std::pair<int,int>> by_degree;
         for (int i = 0; i < (int)db.instances.size(); ++i) {
-            if (db.instances[i].is_fixed) continue;
-            int deg = 0;
-            auto it = inst_to_nets_map.find(i);
-            if (it != inst_to_nets_map.end()) deg = (int)it->second.size();
-            movable_candidates.push_back({deg, i});
-        }
-        if (movable_candidates.empty() || db.rows.empty()) return;
-        std::sort(movable_candidates.begin(), movable_candidates.end(),
-                  [](const std::pair<int,int>& a, const std::pair<int,int>& b){
-                      if (a.first == b.first) return a.second < b.second;
-                      return a.first > b.first;
-                  });
-        std::vector<int> movable_inst_ids;
-        for (const auto& p : movable_candidates) movable_inst_ids.push_back(p.second);
+            if (!db.instances[i].is_fixed) by_degree.push_back({nl.cellDegree(i), i});
+        }
+        std::sort(by_degree.begin(), by_degree.end(), [](const std::pair<int,int>& a, const std::pair<int,int>& b){
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+        if ((int)by_degree.size() > max_cells) by_degree.resize(std::max(max_cells, 0));
+        std::vector<int> order;
+        order.reserve(by_degree.size());
+        for (const auto& p : by_degree) order.push_back(p.second);
+        return order;
+    }
+
+    // Speculative evaluation. Cells are taken kBatch at a time; workers pick
+    // each cell's move against the placement as it stood when the batch
+    // started, then this thread commits the moves in order. A commit stamps
+    // the nets, rows and cells it changed with the batch number. A later
+    // move of the batch is stale if its cell or partner already moved, if
+    // its slot on a stamped row was taken, or if its nets are stamped and
+    // its recomputed gain is gone; a stale move's cell is evaluated again
+    // here and its new move applied. The batch size is fixed, so the result
+    // does not depend on the thread count.
+    template <typename Eval>
+    void runSpeculative(const std::vector<int>& order, Eval eval) {
+        const int kBatch = 1024;
+        const int kChunk = 16;
+        if ((int)spec_scratch.size() < pool.size()) {
+            int old_size = spec_scratch.size();
+            spec_scratch.resize(pool.size());
+            for (int w = old_size; w < pool.size(); ++w) spec_scratch[w].affected.init(nl.numNets());
+        }
+        if ((int)net_stamp.size() != nl.numNets()) net_stamp.assign(nl.numNets(), 0);
+        if (row_stamp.size() != db.rows.size()) row_stamp.assign(db.rows.size(), 0);
+        if (cell_stamp.size() != db.instances.size()) cell_stamp.assign(db.instances.size(), 0);
+
+        for (size_t first = 0; first < order.size(); first += kBatch) {
+            if (pastDeadline()) break;
+            int n = (int)std::min<size_t>(kBatch, order.size() - first);
+            spec_moves.assign(n, SpecMove());
+            pool.parallelFor((n + kChunk - 1) / kChunk, [&](int chunk, int worker) {
+                for (int k = chunk * kChunk; k < std::min(n, (chunk + 1) * kChunk); ++k)
+                    spec_moves[k] = eval(spec_scratch[worker], order[first + k]);
+            });
+            ++spec_batch;
+            for (const SpecMove& m : spec_moves) {
+                if (!commitSpecMove(m, false)) commitSpecMove(eval(spec_scratch[0], m.cell), true);
+            }
+        }
+        for (auto& ss : spec_scratch) {
+            counters += ss.counters;
+            ss.counters = PassCounters();
+        }
+    }
+
+    // HPWL change of swapping same-size cells a and b, or 1 if the swap is
+    // not allowed.
+    long long swapDelta(SpecScratch& ss, int id_a, int id_b) const {
+        if (id_b == id_a) return 1;
+        const Inst& a = db.instances[id_a];
+        const Inst& b = db.instances[id_b];
+        if (b.is_fixed || b.row_id < 0) return 1;
+        if (a.macro_width != b.macro_width || a.macro_height != b.macro_height) return 1;
+        ss.affected.clear();
+        ss.affected.add(nl.cellNets(id_a));
+        ss.affected.add(nl.cellNets(id_b));
+        if (ss.affected.empty()) return 1;
+        ss.counters.moves_evaluated++;
+        return movedDelta(ss.affected.span(), id_a, b.x, b.y, id_b, a.x, a.y, ss.counters);
+    }
 
-        int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : (db.core_site_width_dbu > 0 ? db.core_site_width_dbu : 200);
+    // GlobalInsertOrSwap for one cell: free slots nearest the optimal-region
+    // center on up to 10 rows nearest it, the row neighbours of the center,
+    // and the two cells of the same width filed nearest it in the bin grid.
+    // The cell's own sites are not offered, since the free-site index is
+    // only read here.
+    SpecMove bestInsertOrSwap(SpecScratch& ss, int id_a) const {
+        SpecMove best;
+        best.cell = id_a;
+        const Inst& a = db.instances[id_a];
+        if (a.row_id < 0) return best;
+        Span<uint32_t> nets_a = nl.cellNets(id_a);
+        if (nets_a.empty()) return best;
+
+        collectNetBoxes(id_a, nets_a, PlacedPos{this}, ss.box, ss.counters);
+        optimalRegionEdges(ss.box, ss.xs, ss.ys);
+        const std::vector<int>& xs = ss.xs;
+        const std::vector<int>& ys = ss.ys;
+        if (xs.size() < 2) return best;
+
+        int optx1 = xs[xs.size()/2 - 1];
+        int optx2 = xs[xs.size()/2];
+        int opty1 = ys[ys.size()/2 - 1];
+        int opty2 = ys[ys.size()/2];
+        int opt_center_x = (optx1 + optx2) / 2;
+        int opt_center_y = (opty1 + opty2) / 2;
+
+        std::vector<std::pair<int,int>>& row_candidates = ss.rows;
+        row_candidates.clear();
+        row_index.forEachRowInY(opty1, opty2, [&](int r){
+            row_candidates.push_back({std::abs(db.rows[r].y - opt_center_y), r});
+        });
+        if (row_candidates.empty()) {
+            int row_height = db.sites.count(db.rows[0].site_name) ? db.sites.at(db.rows[0].site_name).height_dbu :
+                             (db.sites.count("CoreSite") ? db.sites.at("CoreSite").height_dbu : 2400);
+            int nearest = (opt_center_y - db.rows[0].y) / row_height;
+            if (nearest < 0) nearest = 0;
+            if (nearest >= (int)db.rows.size()) nearest = (int)db.rows.size() - 1;
+            row_candidates.push_back({0, nearest});
+        }
+        std::sort(row_candidates.begin(), row_candidates.end(),
+                  [](const std::pair<int,int>& p, const std::pair<int,int>& q){
+                      if (p.first == q.first) return p.second < q.second;
+                      return p.first < q.first;
+                  });
+        if ((int)row_candidates.size() > 10) row_candidates.resize(10);
 
-        auto alignToSite = [&](int x, const Row& row) {
-            int offset = (int)std::llround((double)(x - row.x) / site_width);
-            return row.x + offset * site_width;
+        const long long base_hpwl = boxedHPWL(ss.box, a.x, a.y);
+        auto evalSwap = [&](int id_b) {
+            long long delta = swapDelta(ss, id_a, id_b);
+            if (delta < best.delta) { best.delta = delta; best.partner = id_b; best.row = -1; }
         };
 
-        auto eraseFromRow = [&](Row& row, int inst_id) {
-            for (auto it = row.cell_ids.begin(); it != row.cell_ids.end(); ++it) {
-                if (*it == inst_id) { row.cell_ids.erase(it); break; }
+        for (auto rc : row_candidates) {
+            int row_idx = rc.second;
+            const auto& row = db.rows[row_idx];
+            if (row_index.height(row_idx) > 0 && row_index.height(row_idx) != a.macro_height) continue;
+
+            int slots[2];
+            int num_slots = nearestFreeSlots(row_idx, a.macro_width, opt_center_x, slots);
+            for (int k = 0; k < num_slots; ++k) {
+                ss.counters.moves_evaluated++;
+                ss.counters.hpwl_evals += nets_a.size();
+                long long delta = boxedHPWL(ss.box, slots[k], row.y) - base_hpwl;
+                if (delta < best.delta) { best.delta = delta; best.partner = -1; best.row = row_idx; best.x = slots[k]; }
             }
-        };
 
-        auto sortRow = [&](Row& row) {
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(), [&](int a, int b) {
-                return db.instances[a].x < db.instances[b].x;
+            if (!row.cells.empty()) {
+                size_t k = row.cells.lowerBound(opt_center_x);
+                if (k < row.cells.size()) evalSwap(row.cells.id(k));
+                if (k > 0) evalSwap(row.cells.id(k - 1));
+            }
+        }
+        // The row neighbours of the center rarely share A's width; the
+        // grid gives the nearest cells that do.
+        int near1 = -1, near2 = -1;
+        long long d1 = std::numeric_limits<long long>::max(), d2 = d1;
+        auto center_bin = grid.getBinIndex(opt_center_x, opt_center_y);
+        for (int id : grid.cellsOfWidth(center_bin.first, center_bin.second, a.macro_width)) {
+            const Inst& c = db.instances[id];
+            long long d = std::llabs((long long)c.x - opt_center_x) + std::llabs((long long)c.y - opt_center_y);
+            if (d < d1) { near2 = near1; d2 = d1; near1 = id; d1 = d; }
+            else if (d < d2) { near2 = id; d2 = d; }
+        }
+        if (near1 >= 0) evalSwap(near1);
+        if (near2 >= 0) evalSwap(near2);
+        return best;
+    }
+
+    bool slotFree(int row_id, int x, int width) const {
+        int s0, s1;
+        siteRange(row_id, x, (long long)x + width, space_site_width, s0, s1);
+        return row_space[row_id].findFirstFit(s0, s1 - s0) == s0;
+    }
+
+    // Applies m unless a commit earlier in the batch invalidated it. Returns
+    // false if it was invalidated, so the caller can evaluate the cell again;
+    // a fresh move was evaluated after those commits and is not checked.
+    bool commitSpecMove(const SpecMove& m, bool fresh) {
+        const int id_a = m.cell, id_b = m.partner;
+        Inst& a = db.instances[id_a];
+        affected.clear();
+        affected.add(nl.cellNets(id_a));
+        if (id_b >= 0) affected.add(nl.cellNets(id_b));
+        bool stale = false;
+        if (!fresh) {
+            if (cell_stamp[id_a] == spec_batch || (id_b >= 0 && cell_stamp[id_b] == spec_batch)) return false;
+            for (uint32_t net : affected.span()) {
+                if (net_stamp[net] == spec_batch) { stale = true; break; }
+            }
+        }
+        if (m.delta >= 0) return !stale;
+        if (stale) {
+            counters.moves_evaluated++;
+            long long delta;
+            if (id_b >= 0) {
+                const Inst& b = db.instances[id_b];
+                delta = movedDelta(affected.span(), id_a, b.x, b.y, id_b, a.x, a.y, counters);
+            } else {
+                delta = movedDelta(affected.span(), id_a, m.x, db.rows[m.row].y, -1, 0, 0, counters);
+            }
+            if (delta >= 0) return false;
+        }
+
+        row_stamp[a.row_id] = spec_batch;
+        releaseSpace(id_a);
+        if (id_b < 0) {
+            if (!fresh && row_stamp[m.row] == spec_batch && !slotFree(m.row, m.x, a.macro_width)) {
+                occupySpace(id_a);
+                return false;
+            }
+            removeFromRow(id_a);
+            a.x = m.x;
+            a.y = db.rows[m.row].y;
+            a.row_id = m.row;
+            a.orient = db.rows[m.row].orient;
+            addToRow(id_a);
+            occupySpace(id_a);
+        } else {
+            Inst& b = db.instances[id_b];
+            row_stamp[b.row_id] = spec_batch;
+            releaseSpace(id_b);
+            removeFromRow(id_a);
+            removeFromRow(id_b);
+            std::swap(a.x, b.x); std::swap(a.y, b.y); std::swap(a.row_id, b.row_id);
+            a.orient = db.rows[a.row_id].orient; b.orient = db.rows[b.row_id].orient;
+            addToRow(id_a);
+            addToRow(id_b);
+            occupySpace(id_a);
+            occupySpace(id_b);
+            cell_stamp[id_b] = spec_batch;
+        }
+        row_stamp[a.row_id] = spec_batch;
+        cell_stamp[id_a] = spec_batch;
+        for (uint32_t net : affected.span()) net_stamp[net] = spec_batch;
+        counters.moves_accepted++;
+        return true;
+    }
+
+public:
+    // GlobalInsertOrSwap on tiles, in parallel. The rows are cut into bands
+    // and the bands into tiles of about equal size, tiles_per_side per side.
+    // A tile owns the cells lying wholly inside it and the free sites under
+    // it; cells straddling a tile edge stay put. Each tile moves its own
+    // cells within its own area, reading its cells live and every other
+    // cell from a snapshot taken when the round starts. The result therefore
+    // does not depend on the thread count or the order in which tiles run.
+    // The moves are then applied to the rows, free-space index and bin grid
+    // serially. A second round shifts the tiles by half a tile in x and y,
+    // so cells held back by a tile edge can move on.
+    void runTiledInsertOrSwap(int tiles_per_side) {
+        rebuildRowCellIds();
+        if (db.rows.empty()) return;
+        if (tiles_per_side < 1) tiles_per_side = 1;
+
+        if ((int)tile_scratch.size() < pool.size()) {
+            int old_size = tile_scratch.size();
+            tile_scratch.resize(pool.size());
+            for (int w = old_size; w < pool.size(); ++w) tile_scratch[w].affected.init(nl.numNets());
+        }
+        tile_from.resize(db.instances.size());
+        tile_touched.assign(db.instances.size(), 0);
+        tile_snap.resize(db.instances.size());
+        tile_max_width = 0;
+        for (const auto& inst : db.instances) {
+            if (!inst.is_fixed) tile_max_width = std::max(tile_max_width, inst.macro_width);
+        }
+
+        for (int round = 0; round < 2; ++round) {
+            if (pastDeadline()) break;
+            buildTiles(tiles_per_side, round == 1);
+            for (int i = 0; i < (int)db.instances.size(); ++i) {
+                tile_snap[i].x = db.instances[i].x;
+                tile_snap[i].y = db.instances[i].y;
+            }
+            tile_moved.resize(num_tiles);
+            pool.parallelFor(num_tiles, [&](int t, int worker){
+                optimizeTile(tile_scratch[worker], t);
             });
-        };
+            applyTileMoves();
+        }
+        for (auto& ts : tile_scratch) {
+            counters += ts.counters;
+            ts.counters = PassCounters();
+        }
+    }
 
-        int processed = 0;
-        int max_cells = db.instances.size();
-        for (int inst_id_A : movable_inst_ids) {
-            if (processed++ >= max_cells) break;
-            auto& instA = db.instances[inst_id_A];
-            if (instA.row_id < 0) continue;
-            if (inst_to_nets_map.count(inst_id_A) == 0) continue;
+private:
+    struct TilePos { int x, y; };
+    struct TileRow {
+        int row;
+        int s0;                  // first site of the row inside the tile
+        RowFreeSpace space;      // sites [s0, s0 + numSites()) of the row
+        RowCells cells;          // owned cells on the row
+    };
+    struct TileScratch {
+        std::vector<TileRow> rows;                      // the band's rows, bottom to top
+        std::vector<std::pair<int,int>> order;          // (degree, id) of the owned cells
+        std::vector<std::pair<int,int>> row_candidates;
+        std::vector<int> box, xs, ys;
+        NetScratch affected;
+        PassCounters counters;
+    };
+    std::vector<TileScratch> tile_scratch;      // per worker
+    std::vector<int> tile_cut_x;                // tile column edges in dbu
+    std::vector<std::vector<int>> band_rows;    // band -> its rows, bottom to top
+    std::vector<int> row_band, row_band_pos;    // row -> band and position in it, -1 if in none
+    std::vector<int> tile_of;                   // cell -> owning tile, -1 if none
+    std::vector<TilePos> tile_snap;             // positions when the round started
+    std::vector<Slot> tile_from;                // moved cell -> where it was
+    std::vector<char> tile_touched;
+    std::vector<std::vector<int>> tile_moved;   // tile -> cells it moved
+    int num_tiles = 0, num_tile_cols = 0;
+    int tile_max_width = 0;                     // widest movable cell
+
+    // First site of row_id at or right of x, clamped to the row.
+    int tileSite(int row_id, long long x) const {
+        long long r = x - row_index.spanLeft(row_id);
+        long long s = r >= 0 ? (r + space_site_width - 1) / space_site_width : -((-r) / space_site_width);
+        return (int)std::max(0LL, std::min<long long>(s, row_space[row_id].numSites()));
+    }
 
-            const auto& nets_A = inst_to_nets_map.at(inst_id_A);
-            if (nets_A.empty()) continue;
+    // Tile edges, row bands and cell ownership; shifted by half a tile when
+    // shift is set.
+    void buildTiles(int tiles_per_side, bool shift) {
+        long long x_lo = std::numeric_limits<long long>::max(), x_hi = std::numeric_limits<long long>::min();
+        long long y_lo = x_lo, y_hi = x_hi;
+        for (int r = 0; r < (int)db.rows.size(); ++r) {
+            x_lo = std::min(x_lo, row_index.spanLeft(r));
+            x_hi = std::max(x_hi, row_index.spanRight(r));
+            y_lo = std::min<long long>(y_lo, db.rows[r].y);
+            y_hi = std::max<long long>(y_hi, db.rows[r].y + 1);
+        }
+        auto cuts = [&](long long lo, long long hi, std::vector<int>& out) {
+            long long step = std::max(1LL, (hi - lo + tiles_per_side - 1) / tiles_per_side);
+            out.assign(1, (int)lo);
+            for (long long v = lo + (shift ? step / 2 : step); v < hi; v += step) {
+                if (v > out.back()) out.push_back((int)v);
+            }
+            out.push_back((int)hi);
+        };
+        std::vector<int> cut_y;
+        cuts(x_lo, x_hi, tile_cut_x);
+        cuts(y_lo, y_hi, cut_y);
+        num_tile_cols = (int)tile_cut_x.size() - 1;
+        int num_bands = (int)cut_y.size() - 1;
+        num_tiles = num_tile_cols * num_bands;
+
+        band_rows.assign(num_bands, std::vector<int>());
+        row_band.assign(db.rows.size(), -1);
+        row_band_pos.assign(db.rows.size(), -1);
+        std::vector<std::pair<int,int>> by_y;
+        for (int r = 0; r < (int)db.rows.size(); ++r) by_y.push_back({db.rows[r].y, r});
+        std::sort(by_y.begin(), by_y.end());
+        for (const auto& e : by_y) {
+            int b = (int)(std::upper_bound(cut_y.begin(), cut_y.end(), e.first) - cut_y.begin()) - 1;
+            b = std::max(0, std::min(b, num_bands - 1));
+            row_band[e.second] = b;
+            row_band_pos[e.second] = (int)band_rows[b].size();
+            band_rows[b].push_back(e.second);
+        }
 
-            std::vector<int> xs, ys;
-            xs.reserve(nets_A.size() * 2);
-            ys.reserve(nets_A.size() * 2);
-
-            for (int net_id : nets_A) {
-                if (net_id < 0 || net_id >= (int)db.nets.size()) continue;
-                int x1 = std::numeric_limits<int>::max();
-                int x2 = std::numeric_limits<int>::min();
-                int y1 = std::numeric_limits<int>::max();
-                int y2 = std::numeric_limits<int>::min();
-                bool found = false;
-                for (const auto& pin : db.nets[net_id].pins) {
-                    int px = 0, py = 0;
-                    bool ok = false;
-                    if (pin.is_port) {
-                        auto it = db.io_pins.find(pin.port_name);
-                        if (it != db.io_pins.end()) { px = it->second.x; py = it->second.y; ok = true; }
-                    } else if (pin.inst_id >= 0 && pin.inst_id < (int)db.instances.size() && pin.inst_id != inst_id_A) {
-                        const auto& inst = db.instances[pin.inst_id];
-                        px = inst.x; py = inst.y; ok = true;
-                    }
-                    if (ok) {
-                        x1 = std::min(x1, px); x2 = std::max(x2, px);
-                        y1 = std::min(y1, py); y2 = std::max(y2, py);
-                        found = true;
-                    }
-                }
-                if (found) {
-                    xs.push_back(x1); xs.push_back(x2);
-                    ys.push_back(y1); ys.push_back(y2);
-                }
+        tile_of.assign(db.instances.size(), -1);
+        std::vector<int> edge(num_tile_cols + 1);
+        for (int r = 0; r < (int)db.rows.size(); ++r) {
+            for (int c = 0; c <= num_tile_cols; ++c) edge[c] = tileSite(r, tile_cut_x[c]);
+            for (const auto& e : db.rows[r].cells) {
+                const Inst& inst = db.instances[e.id];
+                if (inst.is_fixed) continue;
+                int s0, s1;
+                siteRange(r, inst.x, (long long)inst.x + inst.macro_width, space_site_width, s0, s1);
+                int c = (int)(std::upper_bound(edge.begin(), edge.end(), s0) - edge.begin()) - 1;
+                if (c < 0 || c >= num_tile_cols || s1 > edge[c + 1]) continue;
+                tile_of[e.id] = row_band[r] * num_tile_cols + c;
             }
-            if (xs.size() < 2) continue;
-            std::sort(xs.begin(), xs.end());
-            std::sort(ys.begin(), ys.end());
+        }
+    }
 
-            int optx1 = xs[xs.size()/2 - 1];
-            int optx2 = xs[xs.size()/2];
-            int opty1 = ys[ys.size()/2 - 1];
-            int opty2 = ys[ys.size()/2];
-            int opt_center_x = (optx1 + optx2) / 2;
-            int opt_center_y = (opty1 + opty2) / 2;
+    void tilePinPos(int32_t ref, int tile, int& x, int& y) const {
+        if (ref < 0) { x = nl.io_x[~ref]; y = nl.io_y[~ref]; return; }
+        if (tile_of[ref] == tile) { x = db.instances[ref].x; y = db.instances[ref].y; }
+        else { x = tile_snap[ref].x; y = tile_snap[ref].y; }
+    }
 
-            std::vector<std::pair<int,int>> row_candidates;
-            for (int r = 0; r < (int)db.rows.size(); ++r) {
-                if (db.rows[r].y < opty1 || db.rows[r].y > opty2) continue;
-                row_candidates.push_back({std::abs(db.rows[r].y - opt_center_y), r});
-            }
-            if (row_candidates.empty()) {
-                int row_height = db.sites.count(db.rows[0].site_name) ? db.sites.at(db.rows[0].site_name).height_dbu :
-                                 (db.sites.count("CoreSite") ? db.sites.at("CoreSite").height_dbu : 2400);
-                int nearest = (opt_center_y - db.rows[0].y) / row_height;
-                if (nearest < 0) nearest = 0;
-                if (nearest >= (int)db.rows.size()) nearest = (int)db.rows.size() - 1;
-                row_candidates.push_back({0, nearest});
-            }
-            std::sort(row_candidates.begin(), row_candidates.end(),
-                      [](const std::pair<int,int>& a, const std::pair<int,int>& b){
-                          if (a.first == b.first) return a.second < b.second;
-                          return a.first < b.first;
-                      });
-            if ((int)row_candidates.size() > 10) row_candidates.resize(10);
-
-            long long base_hpwl = calculatePartialHPWL(nets_A);
-            struct Move { long long delta=0; bool has=false; bool is_swap=false; int row=-1; int x=0; int swap_id=-1; };
-            Move best;
-
-            auto evalInsert = [&](int row_idx, int x_pos){
-                auto& row = db.rows[row_idx];
-                int old_x = instA.x, old_y = instA.y, old_row = instA.row_id;
-                std::string old_orient = instA.orient;
-                instA.x = x_pos; instA.y = row.y; instA.row_id = row_idx; instA.orient = row.orient;
-                long long hpwl_new = calculatePartialHPWL(nets_A);
-                long long delta = hpwl_new - base_hpwl;
-                instA.x = old_x; instA.y = old_y; instA.row_id = old_row; instA.orient = old_orient;
-                if (!best.has || delta < best.delta) { best.delta = delta; best.has = true; best.is_swap = false; best.row = row_idx; best.x = x_pos; best.swap_id = -1; }
-            };
-
-            auto evalSwap = [&](int inst_id_B){
-                if (inst_id_B == inst_id_A) return;
-                auto& instB = db.instances[inst_id_B];
-                if (instB.is_fixed || instB.row_id < 0) return;
-                if (instA.macro_width != instB.macro_width || instA.macro_height != instB.macro_height) return;
-                std::set<int> affected = nets_A;
-                if (inst_to_nets_map.count(inst_id_B)) affected.insert(inst_to_nets_map.at(inst_id_B).begin(), inst_to_nets_map.at(inst_id_B).end());
-                if (affected.empty()) return;
-                long long hpwl_old = calculatePartialHPWL(affected);
-                std::string oa = instA.orient, ob = instB.orient;
-                std::swap(instA.x, instB.x); std::swap(instA.y, instB.y); std::swap(instA.row_id, instB.row_id);
-                instA.orient = db.rows[instA.row_id].orient; instB.orient = db.rows[instB.row_id].orient;
-                long long hpwl_new = calculatePartialHPWL(affected);
-                std::swap(instA.x, instB.x); std::swap(instA.y, instB.y); std::swap(instA.row_id, instB.row_id);
-                instA.orient = oa; instB.orient = ob;
-                long long delta = hpwl_new - hpwl_old;
-                if (!best.has || delta < best.delta) { best.delta = delta; best.has = true; best.is_swap = true; best.row = -1; best.x = 0; best.swap_id = inst_id_B; }
-            };
-
-            for (auto rc : row_candidates) {
-                int row_idx = rc.second;
-                auto& row = db.rows[row_idx];
-                if (db.sites.count(row.site_name) && db.sites.at(row.site_name).height_dbu != instA.macro_height) continue;
-
-                std::vector<std::pair<int,int>> segments = row.blockages;
-                segments.reserve(segments.size() + row.cell_ids.size());
-                for (int cid : row.cell_ids) {
-                    if (cid == inst_id_A) continue;
-                    const auto& c = db.instances[cid];
-                    segments.emplace_back(c.x, c.x + c.macro_width);
-                }
-                std::sort(segments.begin(), segments.end(),
-                          [](const std::pair<int,int>& a, const std::pair<int,int>& b){
-                              if (a.first == b.first) return a.second < b.second;
-                              return a.first < b.first;
-                          });
-                std::vector<std::pair<int,int>> merged;
-                for (auto s : segments) {
-                    if (merged.empty() || s.first > merged.back().second) merged.push_back(s);
-                    else merged.back().second = std::max(merged.back().second, s.second);
+    // Local site range [s0, s1) of a cell on tile row tr.
+    void tileSites(const TileRow& tr, const Inst& inst, int& s0, int& s1) const {
+        tileSites(tr, inst.x, inst.macro_width, s0, s1);
+    }
+    void tileSites(const TileRow& tr, int x, int width, int& s0, int& s1) const {
+        siteRange(tr.row, x, (long long)x + width, space_site_width, s0, s1);
+        s0 -= tr.s0;
+        s1 -= tr.s0;
+    }
+
+    void optimizeTile(TileScratch& ts, int tile) {
+        const int band = tile / num_tile_cols, col = tile % num_tile_cols;
+        const int x0 = tile_cut_x[col], x1 = tile_cut_x[col + 1];
+        const std::vector<int>& rows = band_rows[band];
+        PassCounters& c = ts.counters;
+        auto tile_pos = [this, tile](int32_t ref, int& x, int& y) { tilePinPos(ref, tile, x, y); };
+
+        ts.order.clear();
+        ts.rows.resize(rows.size());
+        for (size_t k = 0; k < rows.size(); ++k) {
+            int r = rows[k];
+            const Row& row = db.rows[r];
+            TileRow& tr = ts.rows[k];
+            tr.row = r;
+            tr.s0 = tileSite(r, x0);
+            tr.space.init(tileSite(r, x1) - tr.s0);
+            tr.cells.clear();
+            for (const auto& b : row.blockages) {
+                int s0, s1;
+                siteRange(r, b.first, b.second, space_site_width, s0, s1);
+                tr.space.occupy(s0 - tr.s0, s1 - tr.s0);
+            }
+            // A cell ending inside the tile starts at most one cell width
+            // left of it. Neighbouring tiles move their cells in place
+            // meanwhile, so positions come from the row list, which stays
+            // as it was when the round started.
+            size_t first = row.cells.lowerBound(x0 - tile_max_width);
+            for (size_t e = first; e < row.cells.size() && row.cells.x(e) < x1; ++e) {
+                int id = row.cells.id(e);
+                int s0, s1;
+                tileSites(tr, row.cells.x(e), db.instances[id].macro_width, s0, s1);
+                tr.space.occupy(s0, s1);
+                if (tile_of[id] != tile) continue;
+                tr.cells.push_back(row.cells.x(e), id);
+                ts.order.push_back({nl.cellDegree(id), id});
+            }
+        }
+        std::sort(ts.order.begin(), ts.order.end(), [](const std::pair<int,int>& a, const std::pair<int,int>& b){
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+
+        auto markMoved = [&](int id) {
+            if (tile_touched[id]) return;
+            const Inst& inst = db.instances[id];
+            tile_touched[id] = 1;
+            tile_from[id] = Slot{inst.x, inst.y, inst.row_id};
+            tile_moved[tile].push_back(id);
+        };
+
+        tile_moved[tile].clear();
+        int processed = 0;
+        for (const auto& o : ts.order) {
+            if ((processed++ & 255) == 0 && pastDeadline()) break;
+            const int id_a = o.second;
+            Inst& a = db.instances[id_a];
+            Span<uint32_t> nets_a = nl.cellNets(id_a);
+            if (nets_a.empty()) continue;
+
+            collectNetBoxes(id_a, nets_a, tile_pos, ts.box, c);
+            optimalRegionEdges(ts.box, ts.xs, ts.ys);
+            if (ts.xs.size() < 2) continue;
+            int opty1 = ts.ys[ts.ys.size()/2 - 1], opty2 = ts.ys[ts.ys.size()/2];
+            int center_x = (ts.xs[ts.xs.size()/2 - 1] + ts.xs[ts.xs.size()/2]) / 2;
+            int center_y = (opty1 + opty2) / 2;
+            center_x = std::max(x0, std::min(center_x, x1 - 1));
+
+            // Band rows inside the optimal y range, or the nearest one.
+            ts.row_candidates.clear();
+            int nearest = 0;
+            for (int k = 0; k < (int)rows.size(); ++k) {
+                int y = db.rows[rows[k]].y;
+                if (y >= opty1 && y <= opty2) ts.row_candidates.push_back({std::abs(y - center_y), k});
+                if (std::abs(y - center_y) < std::abs(db.rows[rows[nearest]].y - center_y)) nearest = k;
+            }
+            if (ts.row_candidates.empty()) ts.row_candidates.push_back({0, nearest});
+            std::sort(ts.row_candidates.begin(), ts.row_candidates.end());
+            if ((int)ts.row_candidates.size() > 10) ts.row_candidates.resize(10);
+
+            const long long base = boxedHPWL(ts.box, a.x, a.y);
+            long long best_delta = 0;
+            int best_row = -1, best_x = 0, best_swap = -1;
+
+            TileRow& home = ts.rows[row_band_pos[a.row_id]];
+            int a0, a1;
+            tileSites(home, a, a0, a1);
+            home.space.release(a0, a1);
+            for (const auto& rc : ts.row_candidates) {
+                TileRow& tr = ts.rows[rc.second];
+                const Row& row = db.rows[tr.row];
+                if (row_index.height(tr.row) > 0 && row_index.height(tr.row) != a.macro_height) continue;
+
+                int slots[2];
+                long long left = row_index.spanLeft(tr.row) + (long long)tr.s0 * space_site_width;
+                int num_slots = freeSlotsNear(tr.space, left, a.macro_width, center_x, slots);
+                for (int k = 0; k < num_slots; ++k) {
+                    c.moves_evaluated++;
+                    c.hpwl_evals += nets_a.size();
+                    long long delta = boxedHPWL(ts.box, slots[k], row.y) - base;
+                    if (delta < best_delta) { best_delta = delta; best_row = rc.second; best_x = slots[k]; best_swap = -1; }
                 }
 
-                int row_left = row.x;
-                int row_right = row.x + row.site_count * site_width;
-                int cursor = row_left;
-                auto considerGap = [&](int g0, int g1){
-                    if (g1 - g0 < instA.macro_width) return;
-                    int target = std::min(std::max(opt_center_x, g0), g1 - instA.macro_width);
-                    int pos = alignToSite(target, row);
-                    if (pos < g0) pos = g0;
-                    if (pos + instA.macro_width > g1) pos = g1 - instA.macro_width;
-                    evalInsert(row_idx, pos);
-                };
-                for (auto s : merged) { considerGap(cursor, s.first); cursor = std::max(cursor, s.second); }
-                considerGap(cursor, row_right);
-
-                if (!row.cell_ids.empty()) {
-                    auto it = std::lower_bound(row.cell_ids.begin(), row.cell_ids.end(), opt_center_x,
-                        [&](int id, int val){ return db.instances[id].x < val; });
-                    if (it != row.cell_ids.end()) evalSwap(*it);
-                    if (it != row.cell_ids.begin()) evalSwap(*std::prev(it));
+                if (tr.cells.empty()) continue;
+                size_t k = tr.cells.lowerBound(center_x);
+                for (size_t j = (k > 0 ? k - 1 : 0); j < std::min(k + 1, tr.cells.size()); ++j) {
+                    int id_b = tr.cells.id(j);
+                    Inst& b = db.instances[id_b];
+                    if (id_b == id_a || b.macro_width != a.macro_width || b.macro_height != a.macro_height) continue;
+                    ts.affected.clear();
+                    ts.affected.add(nets_a);
+                    ts.affected.add(nl.cellNets(id_b));
+                    c.moves_evaluated++;
+                    long long delta = netsDelta(ts.affected.span(), tile_pos, MovedPos{id_a, b.x, b.y, id_b, a.x, a.y}, c);
+                    if (delta < best_delta) { best_delta = delta; best_row = -1; best_swap = id_b; }
                 }
             }
 
-            if (!best.has || best.delta >= 0) continue;
-
-            if (!best.is_swap) {
-                int old_row = instA.row_id;
-                eraseFromRow(db.rows[old_row], inst_id_A);
-                instA.x = best.x;
-                instA.y = db.rows[best.row].y;
-                instA.row_id = best.row;
-                instA.orient = db.rows[best.row].orient;
-                auto& dst = db.rows[best.row];
-                auto it_ins = std::lower_bound(dst.cell_ids.begin(), dst.cell_ids.end(), instA.x,
-                    [&](int id, int val){ return db.instances[id].x < val; });
-                dst.cell_ids.insert(it_ins, inst_id_A);
-                if (old_row != best.row) sortRow(db.rows[old_row]);
-                sortRow(db.rows[best.row]);
+            if (best_row < 0 && best_swap < 0) {
+                home.space.occupy(a0, a1);
+                continue;
+            }
+            c.moves_accepted++;
+            markMoved(id_a);
+            home.cells.erase(a.x, id_a);
+            if (best_swap < 0) {
+                TileRow& tr = ts.rows[best_row];
+                a.x = best_x;
+                a.y = db.rows[tr.row].y;
+                a.row_id = tr.row;
+                a.orient = db.rows[tr.row].orient;
+                tr.cells.insert(a.x, id_a);
+                tileSites(tr, a, a0, a1);
+                tr.space.occupy(a0, a1);
             } else {
-                int inst_id_B = best.swap_id;
-                auto& instB = db.instances[inst_id_B];
-                int rowA_old = instA.row_id, rowB_old = instB.row_id;
-                eraseFromRow(db.rows[rowA_old], inst_id_A);
-                eraseFromRow(db.rows[rowB_old], inst_id_B);
-                std::swap(instA.x, instB.x); std::swap(instA.y, instB.y); std::swap(instA.row_id, instB.row_id);
-                instA.orient = db.rows[instA.row_id].orient; instB.orient = db.rows[instB.row_id].orient;
-                db.rows[instA.row_id].cell_ids.push_back(inst_id_A);
-                db.rows[instB.row_id].cell_ids.push_back(inst_id_B);
-                sortRow(db.rows[instA.row_id]);
-                if (instA.row_id != instB.row_id) sortRow(db.rows[instB.row_id]);
+                Inst& b = db.instances[best_swap];
+                TileRow& other = ts.rows[row_band_pos[b.row_id]];
+                markMoved(best_swap);
+                other.cells.erase(b.x, best_swap);
+                std::swap(a.x, b.x); std::swap(a.y, b.y); std::swap(a.row_id, b.row_id);
+                a.orient = db.rows[a.row_id].orient;
+                b.orient = db.rows[b.row_id].orient;
+                other.cells.insert(a.x, id_a);
+                home.cells.insert(b.x, best_swap);
+                // Equal widths: B fills the sites A released.
+                home.space.occupy(a0, a1);
+            }
+        }
+    }
+
+    // Serial step after every round: files the moved cells under their new
+    // positions in the rows, the row free-space index and the bin grid.
+    void applyTileMoves() {
+        for (int t = 0; t < num_tiles; ++t) {
+            for (int id : tile_moved[t]) {
+                const Slot& from = tile_from[id];
+                int s0, s1;
+                siteRange(from.row_id, from.x, (long long)from.x + db.instances[id].macro_width, space_site_width, s0, s1);
+                row_space[from.row_id].release(s0, s1);
+                db.rows[from.row_id].cells.erase(from.x, id);
+            }
+        }
+        for (int t = 0; t < num_tiles; ++t) {
+            for (int id : tile_moved[t]) {
+                addToRow(id);
+                occupySpace(id);
+                tile_touched[id] = 0;
             }
+            tile_moved[t].clear();
         }
     }
 
+public:
+    // Cells in decreasing degree order step row by row toward their optimal
+    // region, taking the first row with an improving free slot or swap (see
+    // runSpeculative).
     void runRowNeighborhoodSwap(int max_cells, int row_window_half) {
         rebuildRowCellIds();
+        syncWideNets();
+        runSpeculative(cellsByDegree(max_cells), [&](SpecScratch& ss, int id) {
+            return firstRowNeighborhoodMove(ss, id, row_window_half);
+        });
+    }
 
-        std::vector<std::pair<int,int>> movable_candidates;
-        for (int i = 0; i < (int)db.instances.size(); ++i) {
-            if (!db.instances[i].is_fixed) {
-                int deg = 0;
-                auto it = inst_to_nets_map.find(i);
-                if (it != inst_to_nets_map.end()) deg = (int)it->second.size();
-                movable_candidates.push_back({deg, i});
-            }
-        }
-        if (movable_candidates.empty()) return;
-        std::sort(movable_candidates.begin(), movable_candidates.end(),
-                  [](const std::pair<int,int>& a, const std::pair<int,int>& b){
-                      if (a.first == b.first) return a.second < b.second;
-                      return a.first > b.first;
-                  });
-        std::vector<int> order;
-        for (auto& p : movable_candidates) order.push_back(p.second);
-
-        int site_width = 200;
-        if (db.sites.count("CoreSite")) site_width = db.sites.at("CoreSite").width_dbu;
-        else if (db.core_site_width_dbu > 0) site_width = db.core_site_width_dbu;
+private:
+    SpecMove firstRowNeighborhoodMove(SpecScratch& ss, int id_a, int row_window_half) const {
+        SpecMove move;
+        move.cell = id_a;
+        const Inst& a = db.instances[id_a];
+        if (a.row_id < 0) return move;
+        Span<uint32_t> nets_a = nl.cellNets(id_a);
+        if (nets_a.empty()) return move;
+
+        collectNetBoxes(id_a, nets_a, PlacedPos{this}, ss.box, ss.counters);
+        optimalRegionEdges(ss.box, ss.xs, ss.ys);
+        const std::vector<int>& xs = ss.xs;
+        const std::vector<int>& ys = ss.ys;
+        if (xs.size() < 2) return move;
+        int opt_center_x = (xs[xs.size()/2 - 1] + xs[xs.size()/2]) / 2;
+        int opt_center_y = (ys[ys.size()/2 - 1] + ys[ys.size()/2]) / 2;
+
+        int dir = (opt_center_y > a.y) ? 1 : (opt_center_y < a.y ? -1 : 0);
+        if (dir == 0) return move;
 
         auto rowHeight = [&](int row_idx)->int{
             if (row_idx < 0 || row_idx >= (int)db.rows.size()) return 0;
-            const auto& row = db.rows[row_idx];
-            if (db.sites.count(row.site_name)) return db.sites.at(row.site_name).height_dbu;
+            if (row_index.height(row_idx) > 0) return row_index.height(row_idx);
             if (db.sites.count("CoreSite")) return db.sites.at("CoreSite").height_dbu;
             return 0;
         };
 
-        auto alignToSite = [&](int x, const Row& row) {
-            int offset = (int)std::llround((double)(x - row.x) / site_width);
-            return row.x + offset * site_width;
-        };
-
-        auto eraseFromRow = [&](Row& row, int inst_id) {
-            for (auto it = row.cell_ids.begin(); it != row.cell_ids.end(); ++it) {
-                if (*it == inst_id) { row.cell_ids.erase(it); break; }
-            }
-        };
-
-        auto sortRow = [&](Row& row) {
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(),
-                      [&](int a, int b){ return db.instances[a].x < db.instances[b].x; });
-        };
-
-        int processed = 0;
-        int success_moves = 0;
-
-        for (int inst_id_A : order) {
-            if (processed++ >= max_cells) break;
-            auto& instA = db.instances[inst_id_A];
-            if (instA.row_id < 0) continue;
-            if (inst_to_nets_map.count(inst_id_A) == 0) continue;
-            const auto& nets_A = inst_to_nets_map.at(inst_id_A);
-            if (nets_A.empty()) continue;
+        const long long base_hpwl = boxedHPWL(ss.box, a.x, a.y);
+        for (int step = 1; step <= row_window_half; ++step) {
+            int row_idx = a.row_id + dir * step;
+            if (row_idx < 0 || row_idx >= (int)db.rows.size()) break;
+            int rh = rowHeight(row_idx);
+            if (rh == 0 || rh != a.macro_height) continue;
+            const auto& row = db.rows[row_idx];
 
-            std::vector<int> xs, ys;
-            xs.reserve(nets_A.size() * 2);
-            ys.reserve(nets_A.size() * 2);
-            for (int net_id : nets_A) {
-                if (net_id < 0 || net_id >= (int)db.nets.size()) continue;
-                int x1 = std::numeric_limits<int>::max();
-                int x2 = std::numeric_limits<int>::min();
-                int y1 = std::numeric_limits<int>::max();
-                int y2 = std::numeric_limits<int>::min();
-                bool found = false;
-                for (const auto& pin : db.nets[net_id].pins) {
-                    int px = 0, py = 0;
-                    bool ok = false;
-                    if (pin.is_port) {
-                        auto itp = db.io_pins.find(pin.port_name);
-                        if (itp != db.io_pins.end()) { px = itp->second.x; py = itp->second.y; ok = true; }
-                    } else if (pin.inst_id >= 0 && pin.inst_id < (int)db.instances.size() && pin.inst_id != inst_id_A) {
-                        const auto& inst = db.instances[pin.inst_id];
-                        px = inst.x; py = inst.y; ok = true;
-                    }
-                    if (ok) {
-                        x1 = std::min(x1, px); x2 = std::max(x2, px);
-                        y1 = std::min(y1, py); y2 = std::max(y2, py);
-                        found = true;
-                    }
-                }
-                if (found) {
-                    xs.push_back(x1); xs.push_back(x2);
-                    ys.push_back(y1); ys.push_back(y2);
-                }
+            int slots[2];
+            int num_slots = nearestFreeSlots(row_idx, a.macro_width, opt_center_x, slots);
+            for (int k = 0; k < num_slots; ++k) {
+                ss.counters.moves_evaluated++;
+                ss.counters.hpwl_evals += nets_a.size();
+                long long delta = boxedHPWL(ss.box, slots[k], row.y) - base_hpwl;
+                if (delta < move.delta) { move.delta = delta; move.row = row_idx; move.x = slots[k]; }
             }
-            if (xs.size() < 2) continue;
-            std::sort(xs.begin(), xs.end());
-            std::sort(ys.begin(), ys.end());
-            int opt_center_x = (xs[xs.size()/2 - 1] + xs[xs.size()/2]) / 2;
-            int opt_center_y = (ys[ys.size()/2 - 1] + ys[ys.size()/2]) / 2;
-
-            int dir = (opt_center_y > instA.y) ? 1 : (opt_center_y < instA.y ? -1 : 0);
-            if (dir == 0) continue;
-
-            int rowA = instA.row_id;
-            for (int step = 1; step <= row_window_half; ++step) {
-                int row_idx = rowA + dir * step;
-                if (row_idx < 0 || row_idx >= (int)db.rows.size()) break;
-                int rh = rowHeight(row_idx);
-                if (rh == 0 || rh != instA.macro_height) continue;
-                auto& row = db.rows[row_idx];
-
-                std::vector<std::pair<int,int>> segments = row.blockages;
-                segments.reserve(segments.size() + row.cell_ids.size());
-                for (int cid : row.cell_ids) {
-                    if (cid == inst_id_A) continue;
-                    const auto& c = db.instances[cid];
-                    segments.emplace_back(c.x, c.x + c.macro_width);
-                }
-                std::sort(segments.begin(), segments.end(),
-                          [](const std::pair<int,int>& a, const std::pair<int,int>& b){
-                              if (a.first == b.first) return a.second < b.second;
-                              return a.first < b.first;
-                          });
-                std::vector<std::pair<int,int>> merged;
-                for (auto s : segments) {
-                    if (merged.empty() || s.first > merged.back().second) merged.push_back(s);
-                    else merged.back().second = std::max(merged.back().second, s.second);
-                }
-
-                int row_left = row.x;
-                int row_right = row.x + row.site_count * site_width;
-                int cursor = row_left;
-                auto considerGap = [&](int g0, int g1, long long base_hpwl)->bool{
-                    if (g1 - g0 < instA.macro_width) return false;
-                    int target = std::min(std::max(opt_center_x, g0), g1 - instA.macro_width);
-                    int pos = alignToSite(target, row);
-                    if (pos < g0) pos = g0;
-                    if (pos + instA.macro_width > g1) pos = g1 - instA.macro_width;
-
-                    int old_x = instA.x, old_y = instA.y, old_row = instA.row_id;
-                    std::string old_orient = instA.orient;
-                    instA.x = pos; instA.y = row.y; instA.row_id = row_idx; instA.orient = row.orient;
-                    long long hpwl_new = calculatePartialHPWL(nets_A);
-                    if (hpwl_new < base_hpwl) {
-                        eraseFromRow(db.rows[old_row], inst_id_A);
-                        auto it_ins = std::lower_bound(row.cell_ids.begin(), row.cell_ids.end(), instA.x,
-                            [&](int id, int val){ return db.instances[id].x < val; });
-                        row.cell_ids.insert(it_ins, inst_id_A);
-                        instA.row_id = row_idx;
-                        success_moves++;
-                        sortRow(db.rows[old_row]);
-                        sortRow(db.rows[row_idx]);
-                        return true;
+            if (move.delta < 0) return move;
+
+            if (!row.cells.empty()) {
+                size_t k = row.cells.lowerBound(opt_center_x);
+                int near[2] = {k < row.cells.size() ? row.cells.id(k) : -1, k > 0 ? row.cells.id(k - 1) : -1};
+                for (int id_b : near) {
+                    if (id_b < 0) continue;
+                    long long delta = swapDelta(ss, id_a, id_b);
+                    if (delta < 0) {
+                        move.delta = delta;
+                        move.partner = id_b;
+                        return move;
                     }
-                    instA.x = old_x; instA.y = old_y; instA.row_id = old_row; instA.orient = old_orient;
-                    return false;
-                };
-
-                long long base_hpwl = calculatePartialHPWL(nets_A);
-                bool moved = false;
-                for (auto s : merged) { if (considerGap(cursor, s.first, base_hpwl)) { moved = true; break; } cursor = std::max(cursor, s.second); }
-                if (!moved && considerGap(cursor, row_right, base_hpwl)) moved = true;
-
-                if (moved) break;
-
-                if (!row.cell_ids.empty()) {
-                    auto it = std::lower_bound(row.cell_ids.begin(), row.cell_ids.end(), opt_center_x,
-                        [&](int id, int val){ return db.instances[id].x < val; });
-                    auto trySwap = [&](int inst_id_B){
-                        if (inst_id_B == inst_id_A) return false;
-                        auto& instB = db.instances[inst_id_B];
-                        if (instB.is_fixed || instB.row_id < 0) return false;
-                        if (instA.macro_width != instB.macro_width || instA.macro_height != instB.macro_height) return false;
-                        std::set<int> affected = nets_A;
-                        if (inst_to_nets_map.count(inst_id_B)) affected.insert(inst_to_nets_map.at(inst_id_B).begin(), inst_to_nets_map.at(inst_id_B).end());
-                        if (affected.empty()) return false;
-                        long long hpwl_old = calculatePartialHPWL(affected);
-                        std::string oa = instA.orient, ob = instB.orient;
-                        std::swap(instA.x, instB.x); std::swap(instA.y, instB.y); std::swap(instA.row_id, instB.row_id);
-                        instA.orient = db.rows[instA.row_id].orient; instB.orient = db.rows[instB.row_id].orient;
-                        long long hpwl_new = calculatePartialHPWL(affected);
-                        if (hpwl_new < hpwl_old) {
-                            eraseFromRow(db.rows[rowA], inst_id_A);
-                            eraseFromRow(db.rows[instB.row_id], inst_id_B);
-                            db.rows[instA.row_id].cell_ids.push_back(inst_id_A);
-                            db.rows[instB.row_id].cell_ids.push_back(inst_id_B);
-                            sortRow(db.rows[instA.row_id]);
-                            if (instA.row_id != instB.row_id) sortRow(db.rows[instB.row_id]);
-                            success_moves++;
-                            return true;
-                        }
-                        std::swap(instA.x, instB.x); std::swap(instA.y, instB.y); std::swap(instA.row_id, instB.row_id);
-                        instA.orient = oa; instB.orient = ob;
-                        return false;
-                    };
-                    if (it != row.cell_ids.end() && trySwap(*it)) break;
-                    if (it != row.cell_ids.begin() && trySwap(*std::prev(it))) break;
                 }
             }
         }
+        return move;
     }
 
+public:
     void runLeftShiftGreedy() {
         rebuildRowCellIds();
+        syncWideNets();
 
         int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : db.core_site_width_dbu;
         if (site_width == 0) site_width = 200;
 
         for (auto& row : db.rows) {
-            if (row.cell_ids.empty()) continue;
+            if (row.cells.empty()) continue;
             int prev_end = row.x;
-            for (int inst_id : row.cell_ids) {
+            for (size_t k = 0; k < row.cells.size(); ++k) {
+                int inst_id = row.cells.id(k);
                 auto& inst = db.instances[inst_id];
                 if (inst.is_fixed) { prev_end = inst.x + inst.macro_width; continue; }
                 int aligned_prev = row.x + ((prev_end - row.x + site_width - 1) / site_width) * site_width;
@@ -762,64 +1759,63 @@ public:
                     prev_end = inst.x + inst.macro_width;
                     continue;
                 }
-                if (inst_to_nets_map.count(inst_id) == 0) {
+                Span<uint32_t> nets = nl.cellNets(inst_id);
+                if (nets.empty()) {
                     inst.x = aligned_prev;
+                    row.cells.setX(k, inst.x);
+                    cellMoved(inst_id);
                     prev_end = inst.x + inst.macro_width;
                     continue;
                 }
-                const auto& nets = inst_to_nets_map.at(inst_id);
-                long long hpwl_old = calculatePartialHPWL(nets);
-                int old_x = inst.x;
-                inst.x = aligned_prev;
-                long long hpwl_new = calculatePartialHPWL(nets);
-                if (hpwl_new >= hpwl_old) inst.x = old_x;
+                counters.moves_evaluated++;
+                if (movedDelta(nets, inst_id, aligned_prev, inst.y, -1, 0, 0, counters) < 0) {
+                    inst.x = aligned_prev;
+                    counters.moves_accepted++;
+                }
+                row.cells.setX(k, inst.x);
+                cellMoved(inst_id);
                 prev_end = inst.x + inst.macro_width;
             }
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(), [&](int a, int b){
-                return db.instances[a].x < db.instances[b].x;
-            });
         }
+        space_synced = false;
     }
 
-    void runRowLegalize() {
-        rebuildRowCellIds();
-
-        int site_width = db.sites.count("CoreSite") ? db.sites.at("CoreSite").width_dbu : db.core_site_width_dbu;
-        if (site_width == 0) site_width = 200;
-
-        auto alignToSite = [&](int x, const Row& row) {
-            int offset = (int)std::llround((double)(x - row.x) / site_width);
-            return row.x + offset * site_width;
-        };
-
-        for (int r = 0; r < (int)db.rows.size(); ++r) {
-            auto& row = db.rows[r];
-            if (row.cell_ids.empty()) continue;
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(),
-                      [&](int a, int b){ return db.instances[a].x < db.instances[b].x; });
-
-            int row_end = row.x + row.site_count * site_width;
-            int cursor = row.x;
-            for (int cid : row.cell_ids) {
-                auto& inst = db.instances[cid];
-                if (inst.is_fixed) {
-                    cursor = std::max(cursor, inst.x + inst.macro_width);
-                    continue;
-                }
-                int x_try = std::max(inst.x, cursor);
-                x_try = alignToSite(x_try, row);
-                x_try = findNextLegalX(x_try, inst.macro_width, row.blockages);
-                if (x_try < cursor) x_try = cursor;
-                if (x_try + inst.macro_width > row_end) x_try = row_end - inst.macro_width;
-                if (x_try < row.x) x_try = row.x;
-                inst.x = x_try;
-                inst.y = row.y;
-                inst.row_id = r;
-                inst.orient = row.orient;
-                cursor = inst.x + inst.macro_width;
-            }
-            std::sort(row.cell_ids.begin(), row.cell_ids.end(),
-                      [&](int a, int b){ return db.instances[a].x < db.instances[b].x; });
+    // Analytical global placement (GlobalPlacer) followed by legalization,
+    // for inputs far from a good placement. Stops at the deadline like the
+    // improvement passes. The result is kept only if it lowers HPWL;
+    // otherwise the starting placement comes back.
+    GlobalPlaceStats runGlobalPlacement(int max_iters) {
+        std::vector<Inst> start = db.instances;
+        GlobalPlaceStats stats;
+        stats.hpwl_before = totalHPWL();
+        {
+            GlobalPlacer gp(db, pool, coreSiteWidth());
+            GlobalPlaceStats run = gp.run(max_iters, 0.1, [&]{ return pastDeadline(); });
+            stats.iterations = run.iterations;
+            stats.cg_iterations = run.cg_iterations;
+            stats.overflow = run.overflow;
+        }
+        LegalizeStats legal = runRowLegalize();
+        stats.hpwl_after = totalHPWL();
+        stats.kept = legal.unplaced == 0 && stats.hpwl_after < stats.hpwl_before;
+        if (!stats.kept) {
+            db.instances.swap(start);
+            rows_synced = false;
+            space_synced = false;
+            grid_synced = false;
+            wide_synced = false;
         }
+        return stats;
+    }
+
+    // Final legalization (AbacusLegalizer). Leaves every cell it could place
+    // on a row segment and row membership in sync.
+    LegalizeStats runRowLegalize() {
+        LegalizeStats stats = legalizer.run(db, row_index, coreSiteWidth(), pool);
+        rows_synced = stats.unplaced == 0;
+        space_synced = false;
+        grid_synced = false;
+        wide_synced = false;
+        return stats;
     }
 };
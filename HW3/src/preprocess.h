@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "db.h"
+#include "hpwl.h"
+
+void buildNetlistView(DesignDB &db) {
+    NetlistView &nl = db.netlist;
+    nl = NetlistView();
+
+    // I/O pins never move: copy them once into a coordinate table indexed
+    // like db.io_pins, so port references resolve through io_pin_of_name.
+    nl.io_x.reserve(db.io_pins.size());
+    nl.io_y.reserve(db.io_pins.size());
+    for (const auto &io : db.io_pins) {
+        nl.io_x.push_back(io.x);
+        nl.io_y.push_back(io.y);
+    }
+
+    size_t total_pins = 0;
+    for (const auto &net : db.nets) total_pins += net.pins.size();
+    nl.net_pin_start.reserve(db.nets.size() + 1);
+    nl.pin_ref.reserve(total_pins);
+
+    const int num_insts = (int)db.instances.size();
+    for (const auto &net : db.nets) {
+        nl.net_pin_start.push_back((uint32_t)nl.pin_ref.size());
+        for (const auto &pin : net.pins) {
+            if (pin.is_port) {
+                int io = (pin.port_name >= 0 && pin.port_name < (int)db.io_pin_of_name.size())
+                             ? db.io_pin_of_name[pin.port_name] : -1;
+                if (io >= 0) nl.pin_ref.push_back(~io);
+            } else if (pin.inst_id >= 0 && pin.inst_id < num_insts) {
+                nl.pin_ref.push_back(pin.inst_id);
+            }
+        }
+    }
+    nl.net_pin_start.push_back((uint32_t)nl.pin_ref.size());
+
+    // cell -> net CSR. Nets are visited in id order, so each cell's list comes
+    // out sorted; last_net drops a second pin of the same cell on one net.
+    std::vector<int> last_net(num_insts, -1);
+    nl.cell_net_start.assign(num_insts + 1, 0);
+    for (int net_id = 0; net_id < nl.numNets(); ++net_id) {
+        for (int32_t ref : nl.netPins(net_id)) {
+            if (ref < 0 || last_net[ref] == net_id) continue;
+            last_net[ref] = net_id;
+            nl.cell_net_start[ref + 1]++;
+        }
+    }
+    for (int i = 0; i < num_insts; ++i) nl.cell_net_start[i + 1] += nl.cell_net_start[i];
+
+    nl.cell_nets.resize(nl.cell_net_start[num_insts]);
+    std::vector<uint32_t> fill(nl.cell_net_start.begin(), nl.cell_net_start.end() - 1);
+    std::fill(last_net.begin(), last_net.end(), -1);
+    for (int net_id = 0; net_id < nl.numNets(); ++net_id) {
+        for (int32_t ref : nl.netPins(net_id)) {
+            if (ref < 0 || last_net[ref] == net_id) continue;
+            last_net[ref] = net_id;
+            nl.cell_nets[fill[ref]++] = (uint32_t)net_id;
+        }
+    }
+}
+
+void stampBlockages(DesignDB &db) {
+    for (const auto& inst : db.instances) {
+
+        if (!inst.is_fixed) continue;
+
+
+        int block_x_start = inst.x;
+        int block_x_end = inst.x + inst.macro_width;
+        int block_y_start = inst.y;
+        int block_y_end = inst.y + inst.macro_height;
+
+
+        for (auto& row : db.rows) {
+
+            if (db.sites.find(row.site_name) == db.sites.end()) continue;
+            int row_height = db.sites.at(row.site_name).height_dbu;
+
+            int row_y_start = row.y;
+            int row_y_end = row.y + row_height;
+
+
+
+            bool y_overlaps = (block_y_start < row_y_end) && (block_y_end > row_y_start);
+
+            if (y_overlaps) {
+
+                row.blockages.push_back( {block_x_start, block_x_end} );
+            }
+        }
+    }
+
+
+    for (auto& row : db.rows) {
+        std::sort(row.blockages.begin(), row.blockages.end());
+    }
+}
+
+
+void linkInstMacro(DesignDB &db) {
+    // One map lookup per distinct macro; null marks one missing from the LEF.
+    std::vector<const Macro*> macro_of(db.macro_names.size(), nullptr);
+    for (int m = 0; m < db.macro_names.size(); ++m) {
+        auto it = db.macros.find(db.macro_names.get(m).str());
+        if (it != db.macros.end()) macro_of[m] = &it->second;
+    }
+    for (size_t i = 0; i < db.instances.size(); ++i) {
+        const Macro* macro = macro_of[db.inst_info[i].macro];
+        if (!macro) continue;
+        db.instances[i].macro_width  = macro->width_dbu;
+        db.instances[i].macro_height = macro->height_dbu;
+    }
+}
+
+
+
+// Position of (x, y) along a Hilbert curve filling an n x n grid, n a
+// power of two.
+static inline uint64_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += (uint64_t)s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) { x = n - 1 - x; y = n - 1 - y; }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+// Renumbers instances along a Hilbert curve through their starting
+// positions, so cells that are near each other on the die, and so usually
+// on the same nets, are near each other in memory too. Nets are then
+// ordered by their lowest instance id. Every instance id the design holds
+// is remapped (net pins, rows, name lookup and the placement records
+// writeDEF patches), so names and the output file are unaffected. Runs
+// before buildNetlistView, which derives its ids from these; a view built
+// earlier is cleared.
+void renumberInstances(DesignDB &db) {
+    const int num_insts = (int)db.instances.size();
+    if (num_insts == 0) return;
+
+    long long x_lo = db.die_x_min, x_hi = db.die_x_max, y_lo = db.die_y_min, y_hi = db.die_y_max;
+    if (x_hi <= x_lo || y_hi <= y_lo) {
+        x_lo = y_lo = std::numeric_limits<long long>::max();
+        x_hi = y_hi = std::numeric_limits<long long>::min();
+        for (const auto &inst : db.instances) {
+            x_lo = std::min<long long>(x_lo, inst.x); x_hi = std::max<long long>(x_hi, inst.x + 1);
+            y_lo = std::min<long long>(y_lo, inst.y); y_hi = std::max<long long>(y_hi, inst.y + 1);
+        }
+    }
+    const uint32_t kGrid = 1u << 16;
+    auto cell = [&](long long v, long long lo, long long hi) {
+        long long c = (v - lo) * kGrid / std::max(1LL, hi - lo);
+        return (uint32_t)std::max(0LL, std::min<long long>(c, kGrid - 1));
+    };
+    std::vector<std::pair<uint64_t, int>> order(num_insts);
+    for (int i = 0; i < num_insts; ++i) {
+        const Inst &inst = db.instances[i];
+        uint32_t hx = cell((long long)inst.x + inst.macro_width / 2, x_lo, x_hi);
+        uint32_t hy = cell((long long)inst.y + inst.macro_height / 2, y_lo, y_hi);
+        order[i] = {hilbertIndex(kGrid, hx, hy), i};
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<int> new_id(num_insts);
+    std::vector<Inst> instances(num_insts);
+    std::vector<InstInfo> info(num_insts);
+    for (int k = 0; k < num_insts; ++k) {
+        int old = order[k].second;
+        new_id[old] = k;
+        instances[k] = db.instances[old];
+        info[k] = db.inst_info[old];
+    }
+    db.instances.swap(instances);
+    db.inst_info.swap(info);
+    auto remap = [&](int id) { return id >= 0 && id < num_insts ? new_id[id] : id; };
+
+    for (int &id : db.inst_of_name) id = remap(id);
+    for (auto &loc : db.def_placements) loc.inst_id = remap(loc.inst_id);
+    for (auto &row : db.rows) {
+        if (row.cells.empty()) continue;
+        for (size_t k = 0; k < row.cells.size(); ++k) row.cells.set(k, row.cells.x(k), remap(row.cells.id(k)));
+        row.cells.sort();
+    }
+
+    std::vector<std::pair<int, int>> net_order(db.nets.size());
+    for (size_t n = 0; n < db.nets.size(); ++n) {
+        int lowest = std::numeric_limits<int>::max();
+        for (auto &pin : db.nets[n].pins) {
+            if (pin.is_port) continue;
+            pin.inst_id = remap(pin.inst_id);
+            if (pin.inst_id >= 0) lowest = std::min(lowest, pin.inst_id);
+        }
+        net_order[n] = {lowest, (int)n};
+    }
+    std::sort(net_order.begin(), net_order.end());
+    std::vector<Net> nets(db.nets.size());
+    for (size_t k = 0; k < net_order.size(); ++k) nets[k] = std::move(db.nets[net_order[k].second]);
+    db.nets.swap(nets);
+    db.netlist = NetlistView();
+}
+
+void assignInstToRows(DesignDB &db) {
+    std::unordered_map<int,int> y2row;
+    for (int i = 0; i < (int)db.rows.size(); ++i) {
+        y2row[db.rows[i].y] = i;
+    }
+    for (int i = 0; i < (int)db.instances.size(); ++i) {
+        auto &inst = db.instances[i];
+        if (inst.is_fixed) continue;
+        auto it = y2row.find(inst.y);
+        if (it == y2row.end()) {
+            continue;
+        }
+        int row_id = it->second;
+        inst.row_id = row_id;
+        db.rows[row_id].cells.push_back(inst.x, i);
+    }
+    for (auto &row : db.rows) row.cells.sort();
+}
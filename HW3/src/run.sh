@@ -17,7 +17,16 @@ mkdir -p ../output
 echo "===== [4/4] 執行 public4 測試案例 ====="
 # 執行 hw3
 # (我修正了你指令中的 './../bin/hw3' 為 '../bin/hw3')
-../bin/hw3 ../testcase/public4.lef ../testcase/public4.def ../output/output.def
+if [ -f ../testcase/public4.def ]; then
+    ../bin/hw3 ../testcase/public4.lef ../testcase/public4.def ../output/output.def
+else
+    # 沒有 public4 時，改用 hw3_gen 產生 10萬 cells 的合成測資
+    echo "找不到 ../testcase/public4.def，改用合成測資 synth_100000"
+    make gen
+    mkdir -p ../testcase
+    [ -f ../testcase/synth_100000.def ] || ../bin/hw3_gen ../testcase/synth_100000 100000
+    ../bin/hw3 ../testcase/synth_100000.lef ../testcase/synth_100000.def ../output/output.def
+fi
 
 echo "===== 執行完畢 ====="
 
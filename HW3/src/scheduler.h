@@ -0,0 +1,158 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "db.h"
+#include "placer.h"
+#include "preprocess.h"
+#include "telemetry.h"
+
+// Picks placement passes by measured payoff instead of a fixed sequence.
+// Every pass runs once, in the order added, to get a first measurement;
+// after that the pass with the best recent HPWL gain per millisecond goes
+// next. A pass whose last run gained less than min_gain_fraction of the
+// current HPWL is set aside until some other pass changes the placement
+// noticeably. The loop ends when the deadline passes or every pass is set
+// aside. The deadline is also handed to the Placer, so a long pass is cut
+// short at its next checkpoint rather than overrunning. Every run is
+// reported to the Telemetry: a console line at verbosity 1 and a "pass"
+// record in the trace.
+class PassScheduler {
+public:
+    using Clock = Placer::DeadlineClock;
+
+    PassScheduler(Placer& placer, DesignDB& db, Telemetry& telemetry)
+        : placer(placer), db(db), telemetry(telemetry) {}
+
+    void addPass(const std::string& name, std::function<void()> run) {
+        passes.push_back(Pass{name, std::move(run)});
+    }
+
+    // Smallest gain, relative to the current HPWL, that counts as progress.
+    double min_gain_fraction = 1e-4;
+
+    // Runs passes until `deadline`; returns the number of passes run.
+    int run(Clock::time_point deadline) {
+        placer.setDeadline(deadline);
+        long long hpwl = placer.totalHPWL();
+        int runs = 0;
+        for (;;) {
+            if (Clock::now() >= deadline) {
+                if (telemetry.verbosity >= 1)
+                    std::cout << "[Sched] Budget reached after " << runs << " passes" << std::endl;
+                break;
+            }
+            int next = pick();
+            if (next < 0) {
+                if (telemetry.verbosity >= 1)
+                    std::cout << "[Sched] No pass improves HPWL any more after " << runs << " passes" << std::endl;
+                break;
+            }
+            Pass& p = passes[next];
+            PassCounters before = placer.passCounters();
+            CacheCounters::Sample cache_before = cache.read();
+            auto t0 = Clock::now();
+            p.run();
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+            CacheCounters::Sample cache_after = cache.read();
+            PassCounters work = placer.passCounters() - before;
+            bool preempted = placer.pastDeadline();
+            long long after = placer.totalHPWL();
+            long long gain = hpwl - after;
+            hpwl = after;
+            ++runs;
+
+            double rate = gain / std::max(ms, 0.01);
+            p.rate = p.runs == 0 ? rate : 0.5 * p.rate + 0.5 * rate;
+            p.runs++;
+            p.total_ms += ms;
+            p.total_gain += gain;
+            p.work += work;
+
+            bool progress = gain > (long long)(min_gain_fraction * hpwl);
+            p.idle = !progress;
+            if (progress) {
+                for (auto& other : passes) if (&other != &p) other.idle = false;
+            }
+            if (telemetry.verbosity >= 1) {
+                std::cout << "[Sched] " << std::left << std::setw(24) << p.name << std::right
+                          << std::fixed << std::setprecision(1) << std::setw(10) << ms << " ms"
+                          << "  gain=" << gain << "  hpwl=" << hpwl
+                          << std::setprecision(0) << "  gain/ms=" << rate
+                          << (preempted ? "  (preempted)" : "") << std::endl;
+            }
+            JsonLine record("pass");
+            record.field("seq", runs)
+                .field("pass", p.name)
+                .field("ms", ms)
+                .field("moves_evaluated", work.moves_evaluated)
+                .field("moves_accepted", work.moves_accepted)
+                .field("delta_hpwl", -gain)
+                .field("hpwl", hpwl)
+                .field("hpwl_evals", work.hpwl_evals)
+                .field("pins_scanned", work.pins_scanned)
+                .field("peak_rss_kb", peakRssKb())
+                .field("preempted", preempted);
+            // The counters see only this thread, so the per-move rates are
+            // only meaningful when the pool has no other workers.
+            if (cache.available() && placer.numThreads() == 1) {
+                long long moves = std::max(1LL, work.moves_evaluated);
+                long long l1d = cache_after.l1d_misses - cache_before.l1d_misses;
+                long long llc = cache_after.llc_misses - cache_before.llc_misses;
+                record.field("l1d_misses", l1d)
+                    .field("llc_misses", llc)
+                    .field("l1d_misses_per_move", (double)l1d / moves)
+                    .field("llc_misses_per_move", (double)llc / moves);
+            }
+            telemetry.emit(record);
+        }
+        placer.clearDeadline();
+        return runs;
+    }
+
+    void report(std::ostream& os) const {
+        os << "===== Pass Schedule =====" << std::endl;
+        for (const auto& p : passes) {
+            os << std::left << std::setw(24) << p.name << std::right
+               << "  runs=" << p.runs
+               << std::fixed << std::setprecision(1) << "  time=" << p.total_ms << " ms"
+               << "  gain=" << p.total_gain
+               << "  moves=" << p.work.moves_evaluated
+               << "  accepted=" << p.work.moves_accepted << std::endl;
+        }
+        os << "=========================" << std::endl;
+    }
+
+private:
+    struct Pass {
+        std::string name;
+        std::function<void()> run;
+        int runs = 0;
+        double rate = 0.0;      // moving average of gain per ms
+        double total_ms = 0.0;
+        long long total_gain = 0;
+        PassCounters work;
+        bool idle = false;
+
+        Pass(const std::string& n, std::function<void()> r) : name(n), run(std::move(r)) {}
+    };
+
+    Placer& placer;
+    DesignDB& db;
+    Telemetry& telemetry;
+    CacheCounters cache;
+    std::vector<Pass> passes;
+
+    int pick() const {
+        for (int i = 0; i < (int)passes.size(); ++i) if (passes[i].runs == 0) return i;
+        int best = -1;
+        for (int i = 0; i < (int)passes.size(); ++i) {
+            if (passes[i].idle) continue;
+            if (best < 0 || passes[i].rate > passes[best].rate) best = i;
+        }
+        return best;
+    }
+};
@@ -0,0 +1,416 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <sys/stat.h>
+#include "db.h"
+#include "mapped_file.h"
+#include "string_pool.h"
+
+// Binary snapshot of a preprocessed DesignDB (after parseLEF/parseDEF,
+// linkInstMacro, stampBlockages, assignInstToRows, renumberInstances and
+// buildNetlistView). Version 3 snapshots hold the renumbered instance order.
+//
+// Layout: a header, then a string table, then a fixed sequence of records.
+// Every record is 8-byte aligned; an array is a uint64 count followed by its
+// raw elements. Strings are stored once in the table and referenced by index.
+// The file is read through an mmap and each array is copied into its vector
+// in one block, so a load does no tokenizing, hashing of macro names or row
+// assignment. The header names the LEF/DEF it was built from (size and
+// mtime); a snapshot that no longer matches them is rejected.
+
+static const char kSnapshotMagic[8] = {'H', 'W', '3', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t kSnapshotVersion = 3;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t lef_size;
+    int64_t lef_mtime;
+    uint64_t def_size;
+    int64_t def_mtime;
+};
+
+struct SnapSite   { int32_t name, width, height; };
+struct SnapMacro  { int32_t name, width, height, is_block; };
+struct SnapRow    { int32_t name, site_name, orient, x, y, site_count, step_x; };
+struct SnapNetPin { int32_t is_port, inst_id, pin_name, port_name; };
+struct SnapIOPin  { int32_t name, x, y, orient; };
+struct SnapPlacement { uint64_t begin, end; int64_t inst_id; };
+
+static bool snapshotSourceStat(const std::string &path, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+    mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+class SnapshotOut {
+public:
+    std::vector<char> buf;
+
+    template <typename T>
+    void value(const T &v) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot values must be POD");
+        append(&v, sizeof(T));
+    }
+
+    template <typename T>
+    void array(const T* p, size_t n) {
+        static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays must be POD");
+        value((uint64_t)n);
+        append(p, n * sizeof(T));
+    }
+
+    template <typename T>
+    void array(const std::vector<T> &v) { array(v.data(), v.size()); }
+
+private:
+    void append(const void* p, size_t n) {
+        const char* c = (const char*)p;
+        buf.insert(buf.end(), c, c + n);
+        buf.resize((buf.size() + 7) & ~(size_t)7, 0);
+    }
+};
+
+class SnapshotIn {
+public:
+    SnapshotIn(const char* begin, const char* end) : p(begin), e(end) {}
+
+    bool ok() const { return good; }
+
+    template <typename T>
+    T value() {
+        T v;
+        std::memset(&v, 0, sizeof(T));
+        const char* at = take(sizeof(T));
+        if (at) std::memcpy(&v, at, sizeof(T));
+        return v;
+    }
+
+    template <typename T>
+    void array(std::vector<T> &out) {
+        uint64_t n = value<uint64_t>();
+        if (!good || n > (uint64_t)(e - p) / sizeof(T)) { good = false; out.clear(); return; }
+        const char* at = take(n * sizeof(T));
+        out.resize(n);
+        if (at && n) std::memcpy(out.data(), at, n * sizeof(T));
+    }
+
+private:
+    const char* p;
+    const char* e;
+    bool good = true;
+
+    const char* take(size_t n) {
+        size_t padded = (n + 7) & ~(size_t)7;
+        if (!good || padded > (size_t)(e - p)) { good = false; return nullptr; }
+        const char* at = p;
+        p += padded;
+        return at;
+    }
+};
+
+bool saveSnapshot(const DesignDB &db, const std::string &lef_path, const std::string &def_path,
+                  const std::string &snap_path) {
+    SnapshotHeader hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.magic, kSnapshotMagic, sizeof(hdr.magic));
+    hdr.version = kSnapshotVersion;
+    if (!snapshotSourceStat(lef_path, hdr.lef_size, hdr.lef_mtime) ||
+        !snapshotSourceStat(def_path, hdr.def_size, hdr.def_mtime)) {
+        std::cerr << "[Snapshot] Cannot stat LEF/DEF, not saving " << snap_path << "\n";
+        return false;
+    }
+
+    StringPool strings;
+    auto sid = [&](StrRef s) { return (int32_t)strings.intern(s); };
+    SnapshotOut body;
+
+    body.value(db.lef_dbu_per_micron);
+    body.value(db.def_dbu_per_micron);
+    body.value(db.core_site_width_dbu);
+    body.value(db.core_site_width_micron);
+    body.value(db.die_x_min);
+    body.value(db.die_y_min);
+    body.value(db.die_x_max);
+    body.value(db.die_y_max);
+    body.value((uint64_t)db.def_size);
+
+    std::vector<SnapSite> sites;
+    for (const auto &kv : db.sites) sites.push_back({sid(kv.first), kv.second.width_dbu, kv.second.height_dbu});
+    body.array(sites);
+    std::vector<SnapMacro> macros;
+    for (const auto &kv : db.macros) {
+        const Macro &m = kv.second;
+        macros.push_back({sid(kv.first), m.width_dbu, m.height_dbu, m.is_block ? 1 : 0});
+    }
+    body.array(macros);
+
+    std::vector<SnapRow> rows;
+    std::vector<uint32_t> blockage_start(1, 0), cell_start(1, 0);
+    std::vector<int32_t> blockages;
+    std::vector<RowCells::Entry> cells;
+    for (const auto &row : db.rows) {
+        rows.push_back({sid(row.name), sid(row.site_name), (int32_t)row.orient,
+                        row.x, row.y, row.site_count, row.step_x});
+        for (const auto &b : row.blockages) { blockages.push_back(b.first); blockages.push_back(b.second); }
+        blockage_start.push_back((uint32_t)blockages.size() / 2);
+        cells.insert(cells.end(), row.cells.begin(), row.cells.end());
+        cell_start.push_back((uint32_t)cells.size());
+    }
+    body.array(rows);
+    body.array(blockage_start);
+    body.array(blockages);
+    body.array(cell_start);
+    body.array(cells);
+
+    // Inst and InstInfo have no pointers, so both arrays are stored raw.
+    body.array(db.instances);
+    body.array(db.inst_info);
+
+    // Name pools are stored in id order, so reinterning reproduces the ids.
+    auto putPool = [&](const StringPool &pool) {
+        std::vector<int32_t> ids(pool.size());
+        for (int k = 0; k < pool.size(); ++k) ids[k] = sid(pool.get(k));
+        body.array(ids);
+    };
+    putPool(db.inst_names);
+    body.array(db.inst_of_name);
+    putPool(db.macro_names);
+    putPool(db.names);
+
+    std::vector<int32_t> net_names;
+    std::vector<uint32_t> net_pin_start(1, 0);
+    std::vector<SnapNetPin> pins;
+    for (const auto &net : db.nets) {
+        net_names.push_back(net.name);
+        for (const auto &pin : net.pins) {
+            pins.push_back({pin.is_port ? 1 : 0, pin.inst_id, pin.pin_name, pin.port_name});
+        }
+        net_pin_start.push_back((uint32_t)pins.size());
+    }
+    body.array(net_names);
+    body.array(net_pin_start);
+    body.array(pins);
+
+    std::vector<SnapIOPin> io_pins;
+    for (const auto &io : db.io_pins) io_pins.push_back({io.name, io.x, io.y, sid(io.orient)});
+    body.array(io_pins);
+    body.array(db.io_pin_of_name);
+
+    std::vector<SnapPlacement> placements;
+    placements.reserve(db.def_placements.size());
+    for (const auto &loc : db.def_placements) placements.push_back({loc.begin, loc.end, loc.inst_id});
+    body.array(placements);
+
+    const NetlistView &nl = db.netlist;
+    body.array(nl.net_pin_start);
+    body.array(nl.pin_ref);
+    body.array(nl.io_x);
+    body.array(nl.io_y);
+    body.array(nl.cell_net_start);
+    body.array(nl.cell_nets);
+
+    SnapshotOut head;
+    head.value(hdr);
+    std::vector<uint32_t> str_start(1, 0);
+    std::vector<char> blob;
+    for (int k = 0; k < strings.size(); ++k) {
+        StrRef s = strings.get(k);
+        blob.insert(blob.end(), s.p, s.p + s.n);
+        str_start.push_back((uint32_t)blob.size());
+    }
+    head.array(str_start);
+    head.array(blob);
+
+    FILE* f = std::fopen(snap_path.c_str(), "wb");
+    if (!f) {
+        std::cerr << "[Snapshot] Cannot open " << snap_path << " for writing\n";
+        return false;
+    }
+    bool ok = std::fwrite(head.buf.data(), 1, head.buf.size(), f) == head.buf.size() &&
+              std::fwrite(body.buf.data(), 1, body.buf.size(), f) == body.buf.size();
+    if (std::fclose(f) != 0) ok = false;
+    if (!ok) {
+        std::cerr << "[Snapshot] Failed writing " << snap_path << "\n";
+        std::remove(snap_path.c_str());
+    }
+    return ok;
+}
+
+// Replaces db with the snapshot at snap_path. Returns false, leaving db
+// untouched, if the file is missing, malformed, from another version, or
+// was built from a different LEF/DEF than the ones given.
+bool loadSnapshot(const std::string &snap_path, const std::string &lef_path, const std::string &def_path,
+                  DesignDB &db) {
+    MappedFile file;
+    if (!file.open(snap_path)) return false;
+    SnapshotIn in(file.data(), file.data() + file.size());
+    auto corrupt = [&]() {
+        std::cerr << "[Snapshot] " << snap_path << " is truncated or corrupt\n";
+        return false;
+    };
+
+    SnapshotHeader hdr = in.value<SnapshotHeader>();
+    if (!in.ok() || std::memcmp(hdr.magic, kSnapshotMagic, sizeof(hdr.magic)) != 0 ||
+        hdr.version != kSnapshotVersion) {
+        std::cerr << "[Snapshot] " << snap_path << " is not a version " << kSnapshotVersion << " snapshot\n";
+        return false;
+    }
+    uint64_t lef_size, def_size;
+    int64_t lef_mtime, def_mtime;
+    if (!snapshotSourceStat(lef_path, lef_size, lef_mtime) || !snapshotSourceStat(def_path, def_size, def_mtime) ||
+        lef_size != hdr.lef_size || lef_mtime != hdr.lef_mtime ||
+        def_size != hdr.def_size || def_mtime != hdr.def_mtime) {
+        std::cerr << "[Snapshot] " << snap_path << " does not match " << lef_path << " / " << def_path << "\n";
+        return false;
+    }
+
+    std::vector<uint32_t> str_start;
+    std::vector<char> blob;
+    in.array(str_start);
+    in.array(blob);
+    if (!in.ok() || str_start.empty() || str_start.back() != blob.size()) return corrupt();
+    const int num_strings = (int)str_start.size() - 1;
+    bool bad_ref = false;
+    auto str = [&](int32_t id) {
+        if (id < 0 || id >= num_strings) { bad_ref = true; return StrRef(); }
+        return StrRef(blob.data() + str_start[id], str_start[id + 1] - str_start[id]);
+    };
+
+    DesignDB out;
+    out.lef_dbu_per_micron = in.value<int>();
+    out.def_dbu_per_micron = in.value<int>();
+    out.core_site_width_dbu = in.value<int>();
+    out.core_site_width_micron = in.value<double>();
+    out.die_x_min = in.value<int>();
+    out.die_y_min = in.value<int>();
+    out.die_x_max = in.value<int>();
+    out.die_y_max = in.value<int>();
+    out.def_size = (size_t)in.value<uint64_t>();
+
+    std::vector<SnapSite> sites;
+    in.array(sites);
+    for (const auto &s : sites) {
+        Site site;
+        site.name = str(s.name).str();
+        site.width_dbu = s.width;
+        site.height_dbu = s.height;
+        out.sites[site.name] = site;
+    }
+    std::vector<SnapMacro> macros;
+    in.array(macros);
+    for (const auto &m : macros) {
+        Macro macro;
+        macro.name = str(m.name).str();
+        macro.width_dbu = m.width;
+        macro.height_dbu = m.height;
+        macro.is_block = m.is_block != 0;
+        out.macros[macro.name] = macro;
+    }
+
+    std::vector<SnapRow> rows;
+    std::vector<uint32_t> blockage_start, cell_start;
+    std::vector<int32_t> blockages;
+    std::vector<RowCells::Entry> cells;
+    in.array(rows);
+    in.array(blockage_start);
+    in.array(blockages);
+    in.array(cell_start);
+    in.array(cells);
+    if (!in.ok() || blockage_start.size() != rows.size() + 1 || cell_start.size() != rows.size() + 1 ||
+        blockage_start.back() * 2 != blockages.size() || cell_start.back() != cells.size()) return corrupt();
+    out.rows.resize(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r) {
+        Row &row = out.rows[r];
+        row.name = str(rows[r].name).str();
+        row.site_name = str(rows[r].site_name).str();
+        if (rows[r].orient < 0 || rows[r].orient > (int32_t)Orient::FE) bad_ref = true;
+        row.orient = (Orient)rows[r].orient;
+        row.x = rows[r].x;
+        row.y = rows[r].y;
+        row.site_count = rows[r].site_count;
+        row.step_x = rows[r].step_x;
+        for (uint32_t b = blockage_start[r]; b < blockage_start[r + 1]; ++b) {
+            row.blockages.push_back({blockages[2 * b], blockages[2 * b + 1]});
+        }
+        row.cells.assign(cells.data() + cell_start[r], cells.data() + cell_start[r + 1]);
+    }
+
+    in.array(out.instances);
+    in.array(out.inst_info);
+    if (!in.ok() || out.inst_info.size() != out.instances.size()) return corrupt();
+    for (const Inst &inst : out.instances) {
+        if ((int)inst.orient > (int)Orient::FE) bad_ref = true;
+    }
+
+    auto getPool = [&](StringPool &pool) {
+        std::vector<int32_t> ids;
+        in.array(ids);
+        pool.reserve(ids.size());
+        for (int32_t id : ids) pool.intern(str(id));
+    };
+    getPool(out.inst_names);
+    in.array(out.inst_of_name);
+    getPool(out.macro_names);
+    getPool(out.names);
+
+    std::vector<int32_t> net_names;
+    std::vector<uint32_t> net_pin_start;
+    std::vector<SnapNetPin> pins;
+    in.array(net_names);
+    in.array(net_pin_start);
+    in.array(pins);
+    if (!in.ok() || net_pin_start.size() != net_names.size() + 1 || net_pin_start.back() != pins.size()) return corrupt();
+    out.nets.resize(net_names.size());
+    for (size_t n = 0; n < net_names.size(); ++n) {
+        Net &net = out.nets[n];
+        net.name = net_names[n];
+        net.pins.resize(net_pin_start[n + 1] - net_pin_start[n]);
+        for (size_t k = 0; k < net.pins.size(); ++k) {
+            const SnapNetPin &s = pins[net_pin_start[n] + k];
+            net.pins[k].is_port = s.is_port != 0;
+            net.pins[k].inst_id = s.inst_id;
+            net.pins[k].pin_name = s.pin_name;
+            net.pins[k].port_name = s.port_name;
+        }
+    }
+
+    std::vector<SnapIOPin> io_pins;
+    in.array(io_pins);
+    for (const auto &s : io_pins) {
+        IOPin io;
+        io.name = s.name;
+        io.x = s.x;
+        io.y = s.y;
+        io.orient = str(s.orient).str();
+        out.io_pins.push_back(io);
+    }
+    in.array(out.io_pin_of_name);
+
+    std::vector<SnapPlacement> placements;
+    in.array(placements);
+    out.def_placements.reserve(placements.size());
+    for (const auto &s : placements) {
+        out.def_placements.push_back({(size_t)s.begin, (size_t)s.end, (int)s.inst_id});
+    }
+
+    NetlistView &nl = out.netlist;
+    in.array(nl.net_pin_start);
+    in.array(nl.pin_ref);
+    in.array(nl.io_x);
+    in.array(nl.io_y);
+    in.array(nl.cell_net_start);
+    in.array(nl.cell_nets);
+
+    if (!in.ok() || bad_ref) return corrupt();
+    db = std::move(out);
+    return true;
+}
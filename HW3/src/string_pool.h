@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Non-owning view of a name, pointing into an input buffer or a StringPool.
+struct StrRef {
+    const char* p = nullptr;
+    uint32_t n = 0;
+
+    StrRef() {}
+    StrRef(const char* s, uint32_t len) : p(s), n(len) {}
+    StrRef(const std::string& s) : p(s.data()), n((uint32_t)s.size()) {}
+
+    bool empty() const { return n == 0; }
+    bool operator==(const StrRef& o) const { return n == o.n && std::memcmp(p, o.p, n) == 0; }
+    bool operator!=(const StrRef& o) const { return !(*this == o); }
+    bool operator==(const char* lit) const { return std::strlen(lit) == n && std::memcmp(p, lit, n) == 0; }
+    bool operator!=(const char* lit) const { return !(*this == lit); }
+    std::string str() const { return std::string(p, n); }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StrRef& s) { return os.write(s.p, s.n); }
+
+// Interner: every distinct string is copied once into a chunked arena and
+// gets a dense id in insertion order. Names must not contain '\0'. Lookups hash the bytes in place, so
+// resolving a name from a parse buffer allocates nothing. Views returned by
+// get() stay valid for the pool's lifetime.
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    int size() const { return (int)strs.size(); }
+    StrRef get(int id) const { return strs[id]; }
+
+    void reserve(size_t n) {
+        strs.reserve(n);
+        hashes.reserve(n);
+        size_t want = 16;
+        while (want < n * 2) want <<= 1;
+        if (want > table.size()) rehash(want);
+    }
+
+    // Id of s, or -1 if it was never interned.
+    int find(StrRef s) const { return find(s, hash(s)); }
+    int intern(StrRef s) { return intern(s, hash(s)); }
+
+    // Variants taking a precomputed hash(s), so callers can hash names in
+    // parallel and only do the table update serially.
+    int find(StrRef s, uint32_t h) const {
+        if (table.empty()) return -1;
+        size_t mask = table.size() - 1;
+        for (size_t i = h & mask; ; i = (i + 1) & mask) {
+            const Slot &slot = table[i];
+            if (slot.id < 0) return -1;
+            if (slot.matches(s, h)) return slot.id;
+        }
+    }
+
+    int intern(StrRef s, uint32_t h) {
+        if ((strs.size() + 1) * 2 > table.size()) rehash(std::max<size_t>(16, table.size() * 2));
+        size_t mask = table.size() - 1;
+        size_t i = h & mask;
+        for (; table[i].id >= 0; i = (i + 1) & mask) {
+            if (table[i].matches(s, h)) return table[i].id;
+        }
+        int id = (int)strs.size();
+        StrRef stored(store(s), s.n);
+        strs.push_back(stored);
+        hashes.push_back(h);
+        table[i] = Slot{stored.p, h, id};
+        return id;
+    }
+
+    uint32_t hashAt(int id) const { return hashes[id]; }
+
+    // Hint that find(.., h) is coming, for loops that resolve many names.
+    void prefetch(uint32_t h) const {
+        if (!table.empty()) __builtin_prefetch(&table[h & (table.size() - 1)]);
+    }
+
+    static uint32_t hash(StrRef s) {
+        uint32_t h = 2166136261u;
+        for (uint32_t k = 0; k < s.n; ++k) h = (h ^ (unsigned char)s.p[k]) * 16777619u;
+        // FNV leaves the low bits of short, similar names ("c1", "c2", ...)
+        // clustered; mix them before they are used as a table index.
+        h ^= h >> 16; h *= 0x85ebca6bu;
+        h ^= h >> 13; h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+private:
+    static const size_t kChunk = 1 << 16;
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t chunk_used = 0, chunk_cap = 0;
+    std::vector<StrRef> strs;
+    std::vector<uint32_t> hashes;
+
+    // A slot carries the hash and the stored (NUL-terminated) string, so a
+    // probe touches only the table and, on a hash match, the arena.
+    struct Slot {
+        const char* p;
+        uint32_t hash;
+        int32_t id;
+        bool matches(StrRef s, uint32_t h) const {
+            return hash == h && std::memcmp(p, s.p, s.n) == 0 && p[s.n] == '\0';
+        }
+    };
+    std::vector<Slot> table;
+
+    const char* store(StrRef s) {
+        if (chunk_used + s.n + 1 > chunk_cap) {
+            chunk_cap = s.n + 1 > kChunk ? s.n + 1 : kChunk;
+            chunks.emplace_back(new char[chunk_cap]);
+            chunk_used = 0;
+        }
+        char* dst = chunks.back().get() + chunk_used;
+        std::memcpy(dst, s.p, s.n);
+        dst[s.n] = '\0';
+        chunk_used += s.n + 1;
+        return dst;
+    }
+
+    void rehash(size_t new_size) {
+        table.assign(new_size, Slot{nullptr, 0, -1});
+        size_t mask = new_size - 1;
+        for (int id = 0; id < (int)strs.size(); ++id) {
+            size_t i = hashes[id] & mask;
+            while (table[i].id >= 0) i = (i + 1) & mask;
+            table[i] = Slot{strs[id].p, hashes[id], id};
+        }
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Peak resident set size of the process so far, in KiB (0 if unknown).
+inline long peakRssKb() {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return ru.ru_maxrss;
+}
+
+// Hardware cache-miss counts of the calling thread through perf_event_open:
+// L1 data-cache read misses, each of which goes to L2 or beyond, and
+// last-level cache read misses. The generic perf events have no L2 miss
+// counter, so the L1D misses stand in for L2 traffic. Only the thread that
+// opens the counters is counted; for a pass on the thread pool that is
+// worker 0. available() is false where the kernel or VM exposes no
+// hardware counters, and every sample then reads zero.
+class CacheCounters {
+public:
+    struct Sample { long long l1d_misses = 0, llc_misses = 0; };
+
+    CacheCounters() {
+#ifdef __linux__
+        fd_l1d = open(PERF_COUNT_HW_CACHE_L1D);
+        fd_llc = open(PERF_COUNT_HW_CACHE_LL);
+#endif
+    }
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+    ~CacheCounters() {
+#ifdef __linux__
+        if (fd_l1d >= 0) close(fd_l1d);
+        if (fd_llc >= 0) close(fd_llc);
+#endif
+    }
+
+    bool available() const { return fd_l1d >= 0 && fd_llc >= 0; }
+
+    Sample read() const {
+        Sample s;
+        if (!available()) return s;
+        s.l1d_misses = value(fd_l1d);
+        s.llc_misses = value(fd_llc);
+        return s;
+    }
+
+private:
+    int fd_l1d = -1, fd_llc = -1;
+
+#ifdef __linux__
+    static int open(unsigned long long cache) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static long long value(int fd) {
+        long long v = 0;
+        return ::read(fd, &v, sizeof(v)) == (ssize_t)sizeof(v) ? v : 0;
+    }
+#else
+    static long long value(int) { return 0; }
+#endif
+};
+
+// One JSON object on one line, built field by field. Keys are written as
+// given; string values are escaped.
+class JsonLine {
+public:
+    explicit JsonLine(const char* event) { field("event", event); }
+
+    JsonLine& field(const char* key, const char* v) {
+        this->key(key);
+        text += '"';
+        for (const char* p = v; *p; ++p) {
+            unsigned char c = *p;
+            if (c == '"' || c == '\\') { text += '\\'; text += (char)c; }
+            else if (c < 0x20) { char esc[8]; std::snprintf(esc, sizeof(esc), "\\u%04x", c); text += esc; }
+            else text += (char)c;
+        }
+        text += '"';
+        return *this;
+    }
+    JsonLine& field(const char* key, const std::string& v) { return field(key, v.c_str()); }
+    JsonLine& field(const char* key, long long v) { this->key(key); text += std::to_string(v); return *this; }
+    JsonLine& field(const char* key, long v) { return field(key, (long long)v); }
+    JsonLine& field(const char* key, int v) { return field(key, (long long)v); }
+    JsonLine& field(const char* key, bool v) { this->key(key); text += v ? "true" : "false"; return *this; }
+    JsonLine& field(const char* key, double v) {
+        this->key(key);
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.3f", v);
+        text += buf;
+        return *this;
+    }
+
+    std::string str() const { return text + "}"; }
+
+private:
+    std::string text = "{";
+
+    void key(const char* k) {
+        if (text.size() > 1) text += ',';
+        text += '"';
+        text += k;
+        text += "\":";
+    }
+};
+
+// Where run-time reporting goes. verbosity gates the console: 0 prints only
+// the final reports, 1 adds per-pass progress, 2 adds design dumps. The
+// trace, when opened, receives one JSON object per line and is flushed per
+// record so a run cut short still leaves a readable prefix.
+class Telemetry {
+public:
+    int verbosity = 1;
+
+    Telemetry() = default;
+    Telemetry(const Telemetry&) = delete;
+    Telemetry& operator=(const Telemetry&) = delete;
+    ~Telemetry() { if (trace) std::fclose(trace); }
+
+    bool openTrace(const std::string& path) {
+        trace = std::fopen(path.c_str(), "w");
+        if (!trace) {
+            std::cerr << "Error: Cannot open trace file: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool tracing() const { return trace != nullptr; }
+
+    void emit(const JsonLine& line) {
+        if (!trace) return;
+        std::fputs(line.str().c_str(), trace);
+        std::fputc('\n', trace);
+        std::fflush(trace);
+    }
+
+private:
+    FILE* trace = nullptr;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. parallelFor() hands out
+// indices [0, n) dynamically and returns once all of them are done; the
+// calling thread takes part as worker 0, so size() threads run in total.
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads = 1) { resize(num_threads); }
+    ~ThreadPool() { stop(); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers.size() + 1; }
+
+    void resize(int num_threads) {
+        stop();
+        stopping = false;
+        for (int w = 1; w < num_threads; ++w) workers.emplace_back(&ThreadPool::workerLoop, this, w);
+    }
+
+    void parallelFor(int n, const std::function<void(int index, int worker)>& fn) {
+        if (n <= 0) return;
+        if (workers.empty() || n == 1) {
+            for (int i = 0; i < n; ++i) fn(i, 0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            job = &fn;
+            job_size = n;
+            next.store(0);
+            busy = (int)workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> lock(mu);
+        done.wait(lock, [&]{ return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mu;
+    std::condition_variable wake, done;
+    const std::function<void(int, int)>* job = nullptr;
+    int job_size = 0;
+    std::atomic<int> next{0};
+    int busy = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+
+    void drain(int worker) {
+        for (int i = next.fetch_add(1); i < job_size; i = next.fetch_add(1)) (*job)(i, worker);
+    }
+
+    void workerLoop(int worker) {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                wake.wait(lock, [&]{ return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            drain(worker);
+            std::lock_guard<std::mutex> lock(mu);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+        workers.clear();
+    }
+};
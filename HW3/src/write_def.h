@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "db.h"
+#include "mapped_file.h"
+
+static char* formatDefInt(char* out, int v) {
+    char tmp[12];
+    int n = 0;
+    unsigned u = v < 0 ? 0u - (unsigned)v : (unsigned)v;
+    do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (v < 0) *out++ = '-';
+    while (n) *out++ = tmp[--n];
+    return out;
+}
+
+// Copies the input DEF through unchanged except for the "( x y ) orient" of
+// each movable component, which parseDEF located by byte offset. The input
+// must be the file that was parsed into db.
+void writeDEF(const DesignDB &db, const std::string &def_in_path, const std::string &def_out_path) {
+    MappedFile fin;
+    if (!fin.open(def_in_path)) {
+        std::cerr << "Error: Cannot open input DEF for writing: " << def_in_path << std::endl;
+        return;
+    }
+    if (fin.size() != db.def_size) {
+        std::cerr << "Error: Input DEF changed since it was parsed: " << def_in_path << std::endl;
+        return;
+    }
+    FILE* fout = std::fopen(def_out_path.c_str(), "wb");
+    if (!fout) {
+        std::cerr << "Error: Cannot open output DEF for writing: " << def_out_path << std::endl;
+        return;
+    }
+    std::vector<char> buf(1 << 20);
+    setvbuf(fout, buf.data(), _IOFBF, buf.size());
+
+    const char* src = fin.data();
+    size_t copied = 0;
+    char patch[64];
+    for (const auto &loc : db.def_placements) {
+        const Inst &inst = db.instances[loc.inst_id];
+        std::fwrite(src + copied, 1, loc.begin - copied, fout);
+        char* p = patch;
+        *p++ = ' '; *p++ = '('; *p++ = ' ';
+        p = formatDefInt(p, inst.x);
+        *p++ = ' ';
+        p = formatDefInt(p, inst.y);
+        *p++ = ' '; *p++ = ')'; *p++ = ' ';
+        for (const char* o = orientName(inst.orient); *o; ++o) *p++ = *o;
+        std::fwrite(patch, 1, p - patch, fout);
+        copied = loc.end;
+    }
+    std::fwrite(src + copied, 1, fin.size() - copied, fout);
+
+    bool ok = !std::ferror(fout);
+    if (std::fclose(fout) != 0) ok = false;
+    if (!ok) std::cerr << "Error: Failed writing output DEF: " << def_out_path << std::endl;
+}